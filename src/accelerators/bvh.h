@@ -5,8 +5,12 @@
 
 #include "../core/object.h"
 #include "../core/hittable_list.h"
+#include "../core/memory.h"
+#include "../shapes/triangle.h"
+#include "../shapes/sphere.h"
+#include "../shapes/aarect.h"
 
-inline bool box_compare(const shared_ptr<Object> a, const shared_ptr<Object> b, int axis)
+inline bool box_compare(const Object *a, const Object *b, int axis)
 {
     AABB box_a;
     AABB box_b;
@@ -17,73 +21,161 @@ inline bool box_compare(const shared_ptr<Object> a, const shared_ptr<Object> b,
     return (box_a.min())[axis] < (box_b.min())[axis];
 }
 
-bool box_x_compare(const shared_ptr<Object> a, const shared_ptr<Object> b)
+bool box_x_compare(const Object *a, const Object *b)
 {
     return box_compare(a, b, 0);
 }
 
-bool box_y_compare(const shared_ptr<Object> a, const shared_ptr<Object> b)
+bool box_y_compare(const Object *a, const Object *b)
 {
     return box_compare(a, b, 1);
 }
 
-bool box_z_compare(const shared_ptr<Object> a, const shared_ptr<Object> b)
+bool box_z_compare(const Object *a, const Object *b)
 {
     return box_compare(a, b, 2);
 }
 
-class BVH : public Object
+// Primitives of one BVH leaf, grouped by concrete type. Triangles keep a packed
+// copy of their vertices and are tested in one tight loop; the other known
+// shapes are called directly through a switch, so only unknown shapes (including
+// filtered primitives) go through the virtual interface.
+class BVHLeaf
 {
 public:
+    // The leaf's arrays come from arena
+    BVHLeaf(const std::vector<Object *> &objects, size_t start, size_t end, SceneArena &arena);
 
-    BVH(const ObjectList &list, double time0, double time1, std::shared_ptr<MediumRecord> mediumRecord = nullptr)
-        : BVH(list.objects, 0, list.objects.size(), time0, time1, mediumRecord)
-    {}
+    bool hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const;
+    bool IntersectHit(const Ray &ray, RawHit &hit) const;
 
-    BVH(const std::vector<shared_ptr<Object>> &src_objects,
-            size_t start, size_t end, double time0, double time1, std::shared_ptr<MediumRecord> mediumRecord = nullptr) : Object(mediumRecord)
+private:
+    struct PackedTriangle
     {
-        auto objects = src_objects;
-
-        int axis = random_int(0, 2);
-        auto comparator = (axis == 0) ? box_x_compare
-                        : (axis == 1) ? box_y_compare
-                                      : box_z_compare;
+        Point3f p0, p1, p2;
+        const Triangle *triangle;
+    };
+    struct Entry
+    {
+        ShapeType type;
+        const Object *object;
+    };
 
-        size_t object_span = end - start;
+    // the primitives themselves are not owned, they live in the scene's arena too
+    PackedTriangle *triangles = nullptr;
+    Entry *entries = nullptr;   // sorted by type
+    uint32_t nTriangles = 0, nEntries = 0;
+};
 
-        if (object_span == 1)
-        {
-            left = right = objects[start];
-        }
-        else if (object_span == 2)
+BVHLeaf::BVHLeaf(const std::vector<Object *> &objects, size_t start, size_t end, SceneArena &arena)
+{
+    for (size_t i = start; i < end; ++i)
+        nTriangles += objects[i]->shapeType == ShapeType::Triangle;
+    nEntries = (uint32_t)(end - start) - nTriangles;
+    triangles = arena.NewArray<PackedTriangle>(nTriangles);
+    entries = arena.NewArray<Entry>(nEntries);
+    uint32_t t = 0, e = 0;
+    for (size_t i = start; i < end; ++i)
+    {
+        const Object *object = objects[i];
+        ShapeType type = object->shapeType;
+        if (type == ShapeType::Triangle)
         {
-            if (comparator(objects[start], objects[start + 1]))
-            {
-                left = objects[start];
-                right = objects[start + 1];
-            }
-            else
-            {
-                left = objects[start + 1];
-                right = objects[start];
-            }
+            const Triangle *tri = static_cast<const Triangle *>(object);
+            triangles[t++] = PackedTriangle{tri->v0, tri->v1, tri->v2, tri};
         }
         else
+            entries[e++] = Entry{type, object};
+    }
+    std::sort(entries, entries + nEntries, [](const Entry &a, const Entry &b) { return a.type < b.type; });
+}
+
+bool BVHLeaf::hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const
+{
+    bool hit_anything = false;
+    for (uint32_t i = 0; i < nTriangles; ++i)
+        if (triangles[i].triangle->hit(r, t_min, hit_anything ? rec.t : t_max, rec))
+            hit_anything = true;
+    for (uint32_t i = 0; i < nEntries; ++i)
+        if (entries[i].object->hit(r, t_min, hit_anything ? rec.t : t_max, rec))
+            hit_anything = true;
+    return hit_anything;
+}
+
+bool BVHLeaf::IntersectHit(const Ray &ray, RawHit &hit) const
+{
+    bool hitAnything = false;
+
+    for (uint32_t i = 0; i < nTriangles; ++i)
+    {
+        const PackedTriangle &tri = triangles[i];
+        float t, b0, b1, b2;
+        if (IntersectTriangle(ray, tri.p0, tri.p1, tri.p2, &t, &b0, &b1, &b2))
         {
-            std::sort(objects.begin() + start, objects.begin() + end, comparator);
+            ray.tMax = t;
+            hit.t = t;
+            hit.u = b1;
+            hit.v = b2;
+            hit.primID = 0;
+            hit.primitive = tri.triangle;
+            hitAnything = true;
+        }
+    }
 
-            auto mid = start + object_span / 2;
-            left = make_shared<BVH>(objects, start, mid, time0, time1, mediumRecord);
-            right = make_shared<BVH>(objects, mid, end, time0, time1, mediumRecord);
+    for (uint32_t i = 0; i < nEntries; ++i)
+    {
+        const Entry &entry = entries[i];
+        bool found;
+        switch (entry.type)
+        {
+        case ShapeType::Sphere:
+            found = static_cast<const Sphere *>(entry.object)->Sphere::IntersectHit(ray, hit);
+            break;
+        case ShapeType::XYRect:
+            found = static_cast<const XYRect *>(entry.object)->XYRect::IntersectHit(ray, hit);
+            break;
+        case ShapeType::XZRect:
+            found = static_cast<const XZRect *>(entry.object)->XZRect::IntersectHit(ray, hit);
+            break;
+        case ShapeType::YZRect:
+            found = static_cast<const YZRect *>(entry.object)->YZRect::IntersectHit(ray, hit);
+            break;
+        default:
+            found = entry.object->IntersectHit(ray, hit);
+            break;
         }
+        hitAnything |= found;
+    }
+    return hitAnything;
+}
 
-        AABB box_left, box_right;
+class BVH : public Object
+{
+public:
+    // Subtrees with at most this many primitives become a single leaf
+    static constexpr size_t MaxLeafPrimitives = 4;
 
-        if (!left->bounding_box(time0, time1, box_left) || !right->bounding_box(time0, time1, box_right))
-            std::cerr << "No bounding box in bvh node constructor.\n";
+    // Nodes and leaves are made in arena, which has to outlive the tree
+    BVH(const ObjectList &list, double time0, double time1, SceneArena &arena,
+        const MediumRecord *mediumRecord = nullptr)
+        : BVH(list.objects, 0, list.objects.size(), time0, time1, arena, mediumRecord)
+    {}
+
+    BVH(const std::vector<Object *> &src_objects,
+            size_t start, size_t end, double time0, double time1, SceneArena &arena,
+            const MediumRecord *mediumRecord = nullptr) : Object(mediumRecord)
+    {
+        // one copy for the whole build, subtrees sort their range of it in place
+        auto objects = src_objects;
+        Build(&objects, start, end, time0, time1, arena);
+    }
 
-        box = surrounding_box(box_left, box_right);
+    // Builds over (*objects)[start, end), reordering that range
+    BVH(std::vector<Object *> *objects,
+            size_t start, size_t end, double time0, double time1, SceneArena &arena,
+            const MediumRecord *mediumRecord) : Object(mediumRecord)
+    {
+        Build(objects, start, end, time0, time1, arena);
     }
 
     virtual bool hit(
@@ -91,13 +183,66 @@ public:
 
     virtual bool bounding_box(double time0, double time1, AABB &output_box) const override;
 
-    virtual bool Intersect(const Ray &ray, HitRecord &isect) const override;
+    virtual bool IntersectHit(const Ray &ray, RawHit &hit) const override;
+
+private:
+    void Build(std::vector<Object *> *objects, size_t start, size_t end,
+               double time0, double time1, SceneArena &arena);
 
 public:
-    shared_ptr<Object> left;
-    shared_ptr<Object> right;
+    // interior nodes have both children, leaf nodes only the leaf; all in the arena
+    const BVH *left = nullptr;
+    const BVH *right = nullptr;
+    const BVHLeaf *leaf = nullptr;
     AABB box;
 };
+// whole trees go away with their arena, no node is ever destroyed on its own
+static_assert(std::is_trivially_destructible<BVHLeaf>::value, "BVHLeaf must not own anything");
+static_assert(std::is_trivially_destructible<BVH>::value, "BVH must not own anything");
+
+void BVH::Build(std::vector<Object *> *objects, size_t start, size_t end,
+                double time0, double time1, SceneArena &arena)
+{
+    // split along the widest spread of centroids; a random axis would make the
+    // tree, and with it the order of equal hits, differ from build to build
+    AABB centroids;
+    for (size_t i = start; i < end; ++i)
+    {
+        AABB object_box;
+        (*objects)[i]->bounding_box(time0, time1, object_box);
+        Point3f c = 0.5f * (object_box.min() + object_box.max());
+        centroids = i == start ? AABB(c, c) : surrounding_box(centroids, AABB(c, c));
+    }
+    int axis = MaxDimension(centroids.max() - centroids.min());
+    auto comparator = (axis == 0) ? box_x_compare
+                    : (axis == 1) ? box_y_compare
+                                  : box_z_compare;
+
+    size_t object_span = end - start;
+
+    if (object_span <= MaxLeafPrimitives)
+    {
+        leaf = arena.New<BVHLeaf>(*objects, start, end, arena);
+        box = AABB();
+        bool first_box = true;
+        for (size_t i = start; i < end; ++i)
+        {
+            AABB object_box;
+            if (!(*objects)[i]->bounding_box(time0, time1, object_box))
+                std::cerr << "No bounding box in bvh node constructor.\n";
+            box = first_box ? object_box : surrounding_box(box, object_box);
+            first_box = false;
+        }
+        return;
+    }
+
+    std::sort(objects->begin() + start, objects->begin() + end, comparator);
+
+    auto mid = start + object_span / 2;
+    left = arena.New<BVH>(objects, start, mid, time0, time1, arena, mediumRecord);
+    right = arena.New<BVH>(objects, mid, end, time0, time1, arena, mediumRecord);
+    box = surrounding_box(left->box, right->box);
+}
 
 bool BVH::bounding_box(double time0, double time1, AABB &output_box) const
 {
@@ -109,6 +254,8 @@ bool BVH::hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const
 {
     if (!box.hit(r, t_min, t_max))
         return false;
+    if (leaf)
+        return leaf->hit(r, t_min, t_max, rec);
 
     bool hit_left = left->hit(r, t_min, t_max, rec);
     bool hit_right = right->hit(r, t_min, hit_left ? rec.t : t_max, rec);
@@ -116,13 +263,16 @@ bool BVH::hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const
     return hit_left || hit_right;
 }
 
-bool BVH::Intersect(const Ray &ray, HitRecord &isect) const {
-    if (!box.hit(ray, 0.0001, ray.tMax)) {
+bool BVH::IntersectHit(const Ray &ray, RawHit &hit) const {
+    if (!box.hit(ray, 0, ray.tMax)) {
         return false;
     }
-    
-    bool hit_left = left->Intersect(ray, isect);
-    bool hit_right = right->Intersect(ray, isect);
+    if (leaf)
+        return leaf->IntersectHit(ray, hit);
+
+    // children are always BVH nodes, so skip the virtual call
+    bool hit_left = left->BVH::IntersectHit(ray, hit);
+    bool hit_right = right->BVH::IntersectHit(ray, hit);
     return hit_left || hit_right;
 }
 
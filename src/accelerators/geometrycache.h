@@ -0,0 +1,90 @@
+#ifndef GEOMETRY_CACHE_H
+#define GEOMETRY_CACHE_H
+
+#include "../core/global.h"
+
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+/*
+LRU cache for geometry generated on demand (e.g. tessellated patches).
+T must provide size_t Bytes() const, Key must be hashable. Entries are handed out as shared_ptr,
+so an evicted entry stays alive until the last ray using it lets go.
+*/
+
+template <typename T, typename Key = uint64_t>
+class GeometryCache {
+public:
+    GeometryCache(size_t maxBytes) : maxBytes(maxBytes) {}
+
+    // Returns the cached entry for key, building it (outside the lock) on a miss
+    std::shared_ptr<const T> Lookup(const Key &key, const std::function<std::shared_ptr<T>()> &build) {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            auto it = entries.find(key);
+            if (it != entries.end()) {
+                ++hits;
+                lru.splice(lru.begin(), lru, it->second);
+                return it->second->second;
+            }
+            ++misses;
+        }
+
+        std::shared_ptr<const T> value = build();
+
+        std::lock_guard<std::mutex> guard(mutex);
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            // another thread built the same entry meanwhile, keep theirs
+            lru.splice(lru.begin(), lru, it->second);
+            return it->second->second;
+        }
+        lru.emplace_front(key, value);
+        entries[key] = lru.begin();
+        bytes += value->Bytes();
+        peakBytes = std::max(peakBytes, bytes);
+        Evict();
+        return value;
+    }
+
+    void Clear() {
+        std::lock_guard<std::mutex> guard(mutex);
+        lru.clear();
+        entries.clear();
+        bytes = 0;
+    }
+
+    void Report(const std::string &name) const {
+        std::lock_guard<std::mutex> guard(mutex);
+        std::cout << "Geometry cache: " << name << "\n";
+        std::cout << "  lookups  : " << hits + misses << " (" << hits << " hits, " << misses << " misses)\n";
+        std::cout << "  evictions: " << evictions << "\n";
+        std::cout << "  memory   : " << bytes / 1024 << " KB resident, " << peakBytes / 1024 << " KB peak, "
+                  << maxBytes / 1024 << " KB cap\n";
+    }
+
+private:
+    // Drops least recently used entries until under the cap, always keeping the newest
+    void Evict() {
+        while (bytes > maxBytes && lru.size() > 1) {
+            auto &last = lru.back();
+            bytes -= last.second->Bytes();
+            entries.erase(last.first);
+            lru.pop_back();
+            ++evictions;
+        }
+    }
+
+    typedef std::list<std::pair<Key, std::shared_ptr<const T>>> EntryList;
+
+    const size_t maxBytes;
+    mutable std::mutex mutex;
+    EntryList lru;
+    std::unordered_map<Key, typename EntryList::iterator> entries;
+    size_t bytes = 0, peakBytes = 0;
+    uint64_t hits = 0, misses = 0, evictions = 0;
+};
+
+#endif
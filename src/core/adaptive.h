@@ -0,0 +1,55 @@
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+#include "spectrum.h"
+
+#include <algorithm>
+
+/*
+per-pixel convergence test for adaptive sampling: running mean and variance
+(Welford) of the sample luminance, a pixel is done once the standard error of
+its mean drops below maxRelativeError times the mean
+*/
+
+// Adaptive sampling of one render: every pixel takes at least minSpp and at
+// most spp samples, stopping at a power of two once its relative error is below
+// maxRelativeError. Off by default: the test trusts the pixel's own running
+// variance, so a dark pixel lit by rare paths, whose first samples happen to
+// agree, stops early and comes out biased dark.
+struct AdaptiveSettings {
+    bool enabled = false;
+    int minSpp = 16;
+    double maxRelativeError = 0.1;
+};
+
+class PixelVariance {
+public:
+    void Add(const Spectrum &L) {
+        double x = L.y();
+        ++n;
+        double delta = x - mean;
+        mean += delta / n;
+        m2 += delta * (x - mean);
+    }
+
+    int Count() const { return n; }
+    double Mean() const { return mean; }
+    double Variance() const { return n > 1 ? m2 / (n - 1) : 0; }
+
+    // Standard error of the mean relative to the mean; nearly black pixels are
+    // judged against minLuminance instead so they can converge at all
+    double RelativeError(double minLuminance = 1e-3) const {
+        if (n < 2) return Infinity;
+        return std::sqrt(Variance() / n) / std::max(mean, minLuminance);
+    }
+
+    bool Converged(double maxRelativeError) const {
+        return RelativeError() <= maxRelativeError;
+    }
+
+private:
+    int n = 0;
+    double mean = 0, m2 = 0;
+};
+
+#endif
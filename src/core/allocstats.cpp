@@ -0,0 +1,77 @@
+#include "allocstats.h"
+
+#include <new>
+
+thread_local uint64_t threadRays = 0;
+
+#ifdef RENDERER_COUNT_ALLOCATIONS
+thread_local uint64_t threadAllocations = 0;
+
+void *operator new(size_t size) {
+    CountAllocation();
+    if (void *ptr = malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    CountAllocation();
+    return malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept {
+    return operator new(size, tag);
+}
+
+// alignas types above the default alignment, e.g. the per-thread scheduler
+// queues and progress counters
+void *operator new(size_t size, std::align_val_t align) {
+    CountAllocation();
+    size_t alignment = (size_t)align;
+    // aligned_alloc wants the size to be a multiple of the alignment
+    size = (size + alignment - 1) & ~(alignment - 1);
+    if (void *ptr = aligned_alloc(alignment, size ? size : alignment)) return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size, std::align_val_t align) {
+    return operator new(size, align);
+}
+
+void *operator new(size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+    try {
+        return operator new(size, align);
+    } catch (const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+
+void *operator new[](size_t size, std::align_val_t align, const std::nothrow_t &tag) noexcept {
+    return operator new(size, align, tag);
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept { free(ptr); }
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { free(ptr); }
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { free(ptr); }
+#endif
+
+void RenderLoopStats::Report() const {
+#ifdef RENDERER_COUNT_ALLOCATIONS
+    uint64_t nAllocs = allocations, nRays = rays;
+    std::cout << "Render loop allocations: " << nAllocs << "\n";
+    std::cout << "  per sample: " << (samples ? (double)nAllocs / samples : 0.) << "\n";
+    std::cout << "  per ray   : " << (nRays ? (double)nAllocs / nRays : 0.) << " (" << nRays << " rays)\n";
+#endif
+}
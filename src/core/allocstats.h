@@ -0,0 +1,43 @@
+#ifndef ALLOCSTATS_H
+#define ALLOCSTATS_H
+
+#include "global.h"
+
+#include <atomic>
+
+/*
+heap allocation and ray counters for the render loop. Allocations are only
+counted when built with -DCOUNT_ALLOCATIONS=ON, which replaces the global
+operator new; otherwise that part compiles to nothing. Rays are always
+counted, the progress reporter shows them as rays/s. The counters are per
+thread, so counting never contends.
+*/
+
+extern thread_local uint64_t threadRays;
+
+inline void CountRay() { ++threadRays; }
+inline uint64_t ThreadRays() { return threadRays; }
+
+#ifdef RENDERER_COUNT_ALLOCATIONS
+extern thread_local uint64_t threadAllocations;
+
+inline void CountAllocation() { ++threadAllocations; }
+inline uint64_t ThreadAllocations() { return threadAllocations; }
+#else
+inline void CountAllocation() {}
+inline uint64_t ThreadAllocations() { return 0; }
+#endif
+
+// Totals over all render threads, each thread adds its deltas once at the end
+struct RenderLoopStats {
+    std::atomic<uint64_t> allocations{0}, rays{0};
+    uint64_t samples = 0;
+
+    void Add(uint64_t threadAllocs, uint64_t threadRays) {
+        allocations += threadAllocs;
+        rays += threadRays;
+    }
+    void Report() const;
+};
+
+#endif
@@ -47,8 +47,8 @@ Spectrum FrConductor(float cosThetaI, const Spectrum &etai,
     return 0.5 * (Rp + Rs);
 }
 
-Spectrum BxDF::Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &u,
-                        float *pdf, BxDFType *sampledType) const {
+Spectrum LambertionReflection::Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &u,
+                                        float *pdf, BxDFType *sampledType) const {
     // Cosine-sample the hemisphere, flipping the direction if necessary
     *wi = CosineSampleHemisphere(u);
     if (wo.z < 0) wi->z *= -1;
@@ -56,14 +56,10 @@ Spectrum BxDF::Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &u,
     return f(wo, *wi);
 }
 
-float BxDF::Pdf(const Vector3f &wo, const Vector3f &wi) const {
+float LambertionReflection::Pdf(const Vector3f &wo, const Vector3f &wi) const {
     return SameHemisphere(wo, wi) ? AbsCosTheta(wi) * invPI : 0;
 }
 
-Spectrum ScaledBxDF::f(const Vector3f &wo, const Vector3f &wi) const {
-    return scale * bxdf->f(wo, wi);
-}
-
 Spectrum FresnelConductor::Evaluate(float cosThetaI) const {
     return FrConductor(std::abs(cosThetaI), etaI, etaT, k);
 }
@@ -75,7 +71,7 @@ Spectrum FresnelDielectric::Evaluate(float cosThetaI) const {
 Spectrum SpecularReflection::Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &sample, float *pdf, BxDFType *sampledType) const {
     *wi = Vector3f(-wo.x, -wo.y, wo.z);
     *pdf = 1;
-    return fresnel->Evaluate(CosTheta(*wi)) * R / AbsCosTheta(*wi);
+    return fresnel.Evaluate(CosTheta(*wi)) * R / AbsCosTheta(*wi);
 }
 
 Spectrum SpecularTransmission::Sample_f(const Vector3f &wo, Vector3f *wi,
@@ -107,8 +103,8 @@ Spectrum MicrofacetReflection::f(const Vector3f &wo, const Vector3f &wi) const {
     if (wh.x == 0 && wh.y == 0 && wh.z == 0) return Spectrum(0.f);
 
     wh = Normalize(wh);
-    Spectrum F = fresnel->Evaluate(Dot(wi, wh));
-    return R * distribution->D(wh) * distribution->G(wo, wi) * F / (4 * cosThetaO * cosThetaI);
+    Spectrum F = fresnel.Evaluate(Dot(wi, wh));
+    return R * distribution.D(wh) * distribution.G(wo, wi) * F / (4 * cosThetaO * cosThetaI);
 }
 
 Spectrum MicrofacetReflection::Sample_f(const Vector3f &wo, Vector3f *wi,
@@ -116,20 +112,20 @@ Spectrum MicrofacetReflection::Sample_f(const Vector3f &wo, Vector3f *wi,
                                         BxDFType *sampledType) const {
     // Sample microfacet orientation $\wh$ and reflected direction $\wi$
     if (wo.z == 0) return 0.;
-    Vector3f wh = distribution->Sample_wh(wo, u);
+    Vector3f wh = distribution.Sample_wh(wo, u);
     if (Dot(wo, wh) < 0) return 0.;   // Should be rare
     *wi = Reflect(wo, wh);
     if (!SameHemisphere(wo, *wi)) return Spectrum(0.f);
 
     // Compute PDF of _wi_ for microfacet reflection
-    *pdf = distribution->Pdf(wo, wh) / (4 * Dot(wo, wh));
+    *pdf = distribution.Pdf(wo, wh) / (4 * Dot(wo, wh));
     return f(wo, *wi);
 }
 
 float MicrofacetReflection::Pdf(const Vector3f &wo, const Vector3f &wi) const {
     if (!SameHemisphere(wo, wi)) return 0;
     Vector3f wh = Normalize(wo + wi);
-    return distribution->Pdf(wo, wh) / (4 * Dot(wo, wh));
+    return distribution.Pdf(wo, wh) / (4 * Dot(wo, wh));
 }
 
 Spectrum MicrofacetTransmission::f(const Vector3f &wo,
@@ -154,7 +150,7 @@ Spectrum MicrofacetTransmission::f(const Vector3f &wo,
     float factor = (mode == TransportMode::Radiance) ? (1 / eta) : 1;
 
     return (Spectrum(1.f) - F) * T *
-           std::abs(distribution->D(wh) * distribution->G(wo, wi) * eta * eta *
+           std::abs(distribution.D(wh) * distribution.G(wo, wi) * eta * eta *
                     AbsDot(wi, wh) * AbsDot(wo, wh) * factor * factor /
                     (cosThetaI * cosThetaO * sqrtDenom * sqrtDenom));
 }
@@ -163,7 +159,7 @@ Spectrum MicrofacetTransmission::Sample_f(const Vector3f &wo, Vector3f *wi,
                                           const Point2f &u, float *pdf,
                                           BxDFType *sampledType) const {
     if (wo.z == 0) return 0.;
-    Vector3f wh = distribution->Sample_wh(wo, u);
+    Vector3f wh = distribution.Sample_wh(wo, u);
     if (Dot(wo, wh) < 0) return 0.;  // Should be rare
 
     float eta = CosTheta(wo) > 0 ? (etaA / etaB) : (etaB / etaA);
@@ -185,7 +181,7 @@ float MicrofacetTransmission::Pdf(const Vector3f &wo,
     float sqrtDenom = Dot(wo, wh) + eta * Dot(wi, wh);
     float dwh_dwi =
         std::abs((eta * eta * Dot(wi, wh)) / (sqrtDenom * sqrtDenom));
-    return distribution->Pdf(wo, wh) * dwh_dwi;
+    return distribution.Pdf(wo, wh) * dwh_dwi;
 }
 
 Spectrum BSDF::f(const Vector3f &woW, const Vector3f &wiW, BxDFType flags) const {
@@ -193,10 +189,10 @@ Spectrum BSDF::f(const Vector3f &woW, const Vector3f &wiW, BxDFType flags) const
     bool reflect = Dot(wiW, n) * Dot(woW, n) > 0;
     Spectrum f(0.f);
     for (int i = 0; i < nBxDFs; ++ i)
-        if (bxdfs[i]->MatchesFlags(flags) &&
-            ((reflect && (bxdfs[i]->type & BSDF_REFLECTION)) ||
-            (!reflect && (bxdfs[i]->type & BSDF_TRANSMISSION))))
-            f += bxdfs[i]->f(wo, wi);
+        if (bxdfs[i].MatchesFlags(flags) &&
+            ((reflect && (bxdfs[i].type & BSDF_REFLECTION)) ||
+            (!reflect && (bxdfs[i].type & BSDF_TRANSMISSION))))
+            f += bxdfs[i].f(wo, wi);
     return f;
 }
 
@@ -210,11 +206,11 @@ Spectrum BSDF::Sample_f(const Vector3f &woWorld, Vector3f *wiWorld, const Point2
     }
     int comp = std::min((int)std::floor(u[0] * matchingComps), matchingComps - 1);
 
-    std::shared_ptr<BxDF> bxdf;
+    const BxDFClosure *bxdf = nullptr;
     int count = comp;
     for (int i = 0; i < nBxDFs; ++i) {
-        if (bxdfs[i]->MatchesFlags(type) && count-- == 0) {
-            bxdf = bxdfs[i];
+        if (bxdfs[i].MatchesFlags(type) && count-- == 0) {
+            bxdf = &bxdfs[i];
             break;
         }
     }
@@ -233,18 +229,18 @@ Spectrum BSDF::Sample_f(const Vector3f &woWorld, Vector3f *wiWorld, const Point2
 
     if (!(bxdf->type & BSDF_SPECULAR) && matchingComps > 1)
         for (int i = 0; i < nBxDFs; ++i)
-            if (bxdfs[i] != bxdf && bxdfs[i]->MatchesFlags(type))
-                *pdf += bxdfs[i]->Pdf(wo, wi);
+            if (&bxdfs[i] != bxdf && bxdfs[i].MatchesFlags(type))
+                *pdf += bxdfs[i].Pdf(wo, wi);
     if (matchingComps > 1) *pdf /= matchingComps;
 
     if (!(bxdf->type & BSDF_SPECULAR)) {
         bool reflect = Dot(*wiWorld, n) * Dot(woWorld, n) > 0;
         f = 0.f;
         for (int i = 0; i < nBxDFs; ++ i)
-            if (bxdfs[i]->MatchesFlags(type) &&
-                ((reflect && (bxdfs[i]->type & BSDF_REFLECTION)) ||
-                (!reflect && (bxdfs[i]->type & BSDF_TRANSMISSION))))
-                f += bxdfs[i]->f(wo, wi);
+            if (bxdfs[i].MatchesFlags(type) &&
+                ((reflect && (bxdfs[i].type & BSDF_REFLECTION)) ||
+                (!reflect && (bxdfs[i].type & BSDF_TRANSMISSION))))
+                f += bxdfs[i].f(wo, wi);
     }
     return f;
 }
@@ -256,20 +252,18 @@ float BSDF::Pdf(const Vector3f &woWorld, const Vector3f &wiWorld, BxDFType flags
     float pdf = 0.f;
     int matchingComps = 0;
     for (int i = 0; i < nBxDFs; ++i)
-        if (bxdfs[i]->MatchesFlags(flags)) {
+        if (bxdfs[i].MatchesFlags(flags)) {
             ++matchingComps;
-            pdf += bxdfs[i]->Pdf(wo, wi);
+            pdf += bxdfs[i].Pdf(wo, wi);
         }
     float v = matchingComps > 0 ? pdf / matchingComps : 0.f;
     return v;
 }
 
-BSDF::~BSDF() {}
-
 int BSDF::NumComponents(BxDFType flags) const {
     int num = 0;
     for (int i = 0; i < nBxDFs; ++i) {
-        if (bxdfs[i]->MatchesFlags(flags)) ++num;
+        if (bxdfs[i].MatchesFlags(flags)) ++num;
     }
     return num;
 }
\ No newline at end of file
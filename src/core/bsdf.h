@@ -5,6 +5,9 @@
 #include "vector.h"
 #include "microfacet.h"
 
+#include <assert.h>
+#include <variant>
+
 // ******************************
 //  BSDF inline functions start
 // ******************************
@@ -71,13 +74,7 @@ enum class TransportMode { Radiance, Importance };
 float FrDielectric(float cosThetaI, float etaI, float etaT);
 Spectrum FrConductor(float cosThetaI, const Spectrum &etai, const Spectrum &etat, const Spectrum &k);
 
-class Fresnel {
-public:
-    virtual ~Fresnel() {}
-    virtual Spectrum Evaluate(float cosI) const = 0;
-};
-
-class FresnelConductor : public Fresnel {
+class FresnelConductor {
 public:
     FresnelConductor(const Spectrum &etaI, const Spectrum &etaT, const Spectrum &k) : etaI(etaI), etaT(etaT), k(k) {}
     Spectrum Evaluate(float cosThetaI) const;
@@ -85,7 +82,7 @@ private:
     Spectrum etaI, etaT, k;
 };
 
-class FresnelDielectric : public Fresnel {
+class FresnelDielectric {
 public:
     Spectrum Evaluate(float cosThetaI) const;
     FresnelDielectric(float etaI, float etaT) : etaI(etaI), etaT(etaT) { }
@@ -94,6 +91,18 @@ private:
     float etaI, etaT;
 };
 
+// Either Fresnel term, held by value inside the lobe that uses it
+class Fresnel {
+public:
+    Fresnel(const FresnelConductor &conductor) : term(conductor) {}
+    Fresnel(const FresnelDielectric &dielectric) : term(dielectric) {}
+    Spectrum Evaluate(float cosThetaI) const {
+        return std::visit([&](const auto &fr) { return fr.Evaluate(cosThetaI); }, term);
+    }
+private:
+    std::variant<FresnelConductor, FresnelDielectric> term;
+};
+
 // ******************************
 //         Fresnel end
 // ******************************
@@ -107,47 +116,22 @@ enum BxDFType {
     BSDF_ALL = BSDF_DIFFUSE | BSDF_GLOSSY | BSDF_SPECULAR | BSDF_REFLECTION | BSDF_TRANSMISSION,
 };
 
+// Common part of the concrete lobes below. There are no virtual functions:
+// a BSDF stores its lobes by value in BxDFClosure and dispatches on their type.
 class BxDF {
 public:
     BxDF(BxDFType type) : type(type) {}
-    virtual ~BxDF() {}
     bool MatchesFlags(BxDFType t) const {
         return (type & t) == type;
     }
-    virtual Spectrum f(const Vector3f &wo, const Vector3f &wi) const = 0;
-    virtual Spectrum Sample_f(const Vector3f &wo, Vector3f *wi,
-                              const Point2f &sample, float *pdf, BxDFType *sampledType) const;
-    virtual Spectrum rho(const Vector3f &wo, int nSamples,
-                         const Point2f &samples) const {}
-    virtual Spectrum rho(int nSamples, const Point2f &samples1,
-                         const Point2f &samples2) const {}
-    virtual float Pdf(const Vector3f &wo, const Vector3f &wi) const;
 
 public:
     const BxDFType type;
 };
 
-class ScaledBxDF : public BxDF {
-public:
-    ScaledBxDF(BxDF *bxdf, const Spectrum &scale) : BxDF(BxDFType(bxdf->type)), bxdf(bxdf), scale(scale) {}
-    Spectrum rho(const Vector3f &w, int nSamples, const Point2f &samples) const {
-        return scale * bxdf->rho(w, nSamples, samples);
-    }
-    Spectrum rho(int nSamples, const Point2f &samples1,
-                 const Point2f &samples2) const {
-                     return scale * bxdf->rho(nSamples, samples1, samples2);
-    }
-    Spectrum f(const Vector3f &wo, const Vector3f &wi) const;
-    Spectrum Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &sample,
-        float *pdf, BxDFType *sampledType) const {}
-public:
-    BxDF *bxdf;
-    Spectrum scale;
-};
-
 class SpecularReflection : public BxDF {
 public:
-    SpecularReflection(const Spectrum &R, std::shared_ptr<Fresnel> fresnel)
+    SpecularReflection(const Spectrum &R, const Fresnel &fresnel)
         : BxDF(BxDFType(BSDF_REFLECTION | BSDF_SPECULAR)), R(R),
           fresnel(fresnel) {}
 
@@ -161,7 +145,7 @@ public:
     }
 private:
     const Spectrum R;
-    const std::shared_ptr<Fresnel> fresnel;
+    const Fresnel fresnel;
 };
 
 class SpecularTransmission : public BxDF {
@@ -211,6 +195,8 @@ public:
         : BxDF(BxDFType(BSDF_DIFFUSE | BSDF_REFLECTION)), R(R) {}
 
     Spectrum f(const Vector3f &wo, const Vector3f &wi) const;
+    Spectrum Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &u, float *pdf, BxDFType *sampledType) const;
+    float Pdf(const Vector3f &wo, const Vector3f &wi) const;
     Spectrum rho(const Vector3f &, int, const Point2f &) const { return R; }
     Spectrum rho(int, const Point2f &, const Point2f &) const { return R; }
 private:
@@ -219,7 +205,7 @@ private:
 
 class MicrofacetReflection : public BxDF {
 public:
-    MicrofacetReflection(const Spectrum &R, std::shared_ptr<MicrofacetDistribution> distribution, std::shared_ptr<Fresnel> fresnel)
+    MicrofacetReflection(const Spectrum &R, const TrowbridgeReitzDistribution &distribution, const Fresnel &fresnel)
         : BxDF(BxDFType(BSDF_REFLECTION | BSDF_GLOSSY)), R(R), distribution(distribution), fresnel(fresnel) {}
 
     Spectrum f(const Vector3f &wo, const Vector3f &wi) const;
@@ -227,13 +213,13 @@ public:
     float Pdf(const Vector3f &wo, const Vector3f &wi) const;
 private:
     const Spectrum R;
-    const std::shared_ptr<MicrofacetDistribution> distribution;
-    const std::shared_ptr<Fresnel> fresnel;
+    const TrowbridgeReitzDistribution distribution;
+    const Fresnel fresnel;
 };
 
 class MicrofacetTransmission : public BxDF {
 public:
-    MicrofacetTransmission(const Spectrum &T, std::shared_ptr<MicrofacetDistribution> distribution, float etaA, float etaB, TransportMode mode)
+    MicrofacetTransmission(const Spectrum &T, const TrowbridgeReitzDistribution &distribution, float etaA, float etaB, TransportMode mode)
         : BxDF(BxDFType(BSDF_TRANSMISSION | BSDF_GLOSSY)), T(T), distribution(distribution), etaA(etaA), etaB(etaB), fresnel(etaA, etaB), mode(mode) {}
 
     Spectrum f(const Vector3f &wo, const Vector3f &wi) const;
@@ -241,12 +227,39 @@ public:
     float Pdf(const Vector3f &wo, const Vector3f &wi) const;
 private:
     const Spectrum T;
-    const std::shared_ptr<MicrofacetDistribution> distribution;
+    const TrowbridgeReitzDistribution distribution;
     const float etaA, etaB;
     const FresnelDielectric fresnel;
     const TransportMode mode;
 };
 
+// Tagged union of the concrete lobes. Evaluation switches on the held type, so
+// there are no indirect calls and the lobe data sits inline in the BSDF.
+class BxDFClosure {
+public:
+    template <typename Lobe>
+    BxDFClosure(const Lobe &lobe) : type(lobe.type), lobe(lobe) {}
+
+    bool MatchesFlags(BxDFType t) const {
+        return (type & t) == type;
+    }
+    Spectrum f(const Vector3f &wo, const Vector3f &wi) const {
+        return std::visit([&](const auto &b) { return b.f(wo, wi); }, lobe);
+    }
+    Spectrum Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &u, float *pdf, BxDFType *sampledType) const {
+        return std::visit([&](const auto &b) { return b.Sample_f(wo, wi, u, pdf, sampledType); }, lobe);
+    }
+    float Pdf(const Vector3f &wo, const Vector3f &wi) const {
+        return std::visit([&](const auto &b) { return b.Pdf(wo, wi); }, lobe);
+    }
+
+public:
+    const BxDFType type;   // copy of the lobe's type, flag tests need no dispatch
+private:
+    std::variant<LambertionReflection, SpecularReflection, SpecularTransmission,
+                 MicrofacetReflection, MicrofacetTransmission> lobe;
+};
+
 class BSDF {
 public:
     BSDF(const Vector3f &n, float eta = 1) : n(n), eta(eta) {
@@ -254,9 +267,10 @@ public:
         sn = Normalize(Cross(n, temp));
         tn = Cross(n, sn);
     }
-    ~BSDF();
-    void Add(std::shared_ptr<BxDF> b) {
-        bxdfs[nBxDFs++] = b;
+    void Add(const BxDFClosure &b) {
+        // a fifth lobe would be constructed past the union, into the next arena object
+        assert(nBxDFs < MaxBxDFs);
+        new (&bxdfs[nBxDFs++]) BxDFClosure(b);
     }
     int NumComponents(BxDFType flags = BSDF_ALL) const;
     Vector3f WorldToLocal(const Vector3f &v) const {
@@ -272,12 +286,15 @@ public:
     float Pdf(const Vector3f &wo, const Vector3f &wi, BxDFType flags = BSDF_ALL) const;
     const float eta;
 private:
+    // BSDFs live in a MemoryArena and are never deleted
+    ~BSDF() {}
 
     const Vector3f n;
     Vector3f sn, tn;
     int nBxDFs = 0;
-    static constexpr int MaxBxDFs = 8;
-    std::shared_ptr<BxDF> bxdfs[MaxBxDFs];
+    // no material uses more than two lobes; only the first nBxDFs slots are constructed
+    static constexpr int MaxBxDFs = 4;
+    union { BxDFClosure bxdfs[MaxBxDFs]; };
 };
 
 #endif
\ No newline at end of file
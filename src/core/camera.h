@@ -68,10 +68,11 @@ public:
         focalDistance = focus_dist;
     }
 
-    Ray get_Ray(double s, double t) const
+    // uLens picks the point on the lens, see Sampler
+    Ray get_Ray(double s, double t, const Point2f &uLens) const
     {
-        Vector3f rd = lens_radius * random_in_unit_disk();
-        Vector3f offset = u * rd.x + v * rd.y;
+        Point2f pLens = ConcentricSampleDisk(uLens) * (float)lens_radius;
+        Vector3f offset = u * pLens.x + v * pLens.y;
 
         return Ray(
             origin + offset,
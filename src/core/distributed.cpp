@@ -0,0 +1,271 @@
+#include "distributed.h"
+#include "net.h"
+#include "progress.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define HAVE_SPAWN
+extern char **environ;
+#endif
+
+// pixels and tiles go over the wire as they are in memory
+static_assert(std::is_trivially_copyable<FilmPixel>::value, "FilmPixel is sent as raw bytes");
+static_assert(std::is_trivially_copyable<Tile>::value, "Tile is sent as raw bytes");
+
+enum MessageType : uint32_t {
+    HelloMessage = 1,   // worker -> coordinator: WorkerHello
+    JobMessage,         // coordinator -> worker: int32 sampleEnd, then the tiles
+    PixelsMessage,      // worker -> coordinator: the tiles' pixels, row by row, tile after tile
+    DoneMessage         // coordinator -> worker: no more work
+};
+
+// lets the coordinator turn away workers that set up a different image
+struct WorkerHello {
+    uint64_t seed;
+    int32_t width, height, spp;
+    int32_t minSpp;            // adaptive sampling, 0 when it is off
+    double maxRelativeError;
+
+    WorkerHello() {}
+    WorkerHello(uint64_t seed, int width, int height, int spp, const AdaptiveSettings &adaptive)
+        : seed(seed), width(width), height(height), spp(spp), minSpp(adaptive.enabled ? adaptive.minSpp : 0),
+          maxRelativeError(adaptive.enabled ? adaptive.maxRelativeError : 0) {}
+};
+
+#ifdef HAVE_SPAWN
+static pid_t SpawnWorker(const std::string &program, int port, int nThreads, uint64_t seed, int spp,
+                         const std::string &sampler, const AdaptiveSettings &adaptive) {
+    std::string address = "127.0.0.1:" + std::to_string(port), threads = std::to_string(nThreads);
+    std::string seedArg = std::to_string(seed), sppArg = std::to_string(spp);
+    std::string minSppArg = std::to_string(adaptive.minSpp);
+    // all digits, the worker's value has to compare equal in its hello
+    std::ostringstream errorArg;
+    errorArg.precision(17);
+    errorArg << adaptive.maxRelativeError;
+    std::string errorString = errorArg.str();
+    std::vector<char *> argv = {(char *)program.c_str(), (char *)"--worker", (char *)address.c_str(),
+                                (char *)"--threads", (char *)threads.c_str(), (char *)"--seed",
+                                (char *)seedArg.c_str(), (char *)"--spp", (char *)sppArg.c_str(),
+                                (char *)"--sampler", (char *)sampler.c_str()};
+    if (adaptive.enabled)
+        for (const char *arg : {"--min-spp", minSppArg.c_str(), "--adaptive-error", errorString.c_str()})
+            argv.push_back((char *)arg);
+    argv.push_back(nullptr);
+    // the worker's own progress output would garble ours, errors still come through
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+    pid_t pid;
+    int err = posix_spawn(&pid, program.c_str(), &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (err != 0) {
+        std::cerr << "ERROR: Could not start worker '" << program << "'.\n";
+        return -1;
+    }
+    return pid;
+}
+#endif
+
+bool RunCoordinator(Film *film, const std::vector<Tile> &tiles, int spp, const CoordinatorOptions &options) {
+    // workers spawned here connect over loopback, nobody else needs to reach the port
+    Socket listener = Socket::Listen(options.port, !options.program.empty());
+    if (!listener.Valid()) return false;
+    int port = listener.Port();
+
+    std::vector<int> children;
+    if (!options.program.empty()) {
+#ifdef HAVE_SPAWN
+        int threads = options.workerThreads > 0 ? options.workerThreads
+                                                : std::max(1, omp_get_num_procs() / options.nWorkers);
+        for (int w = 0; w < options.nWorkers; ++w) {
+            pid_t pid = SpawnWorker(options.program, port, threads, options.seed, spp, options.sampler, options.adaptive);
+            if (pid > 0) children.push_back(pid);
+        }
+        if (children.empty()) return false;
+        std::cout << "Started " << children.size() << " workers with " << threads << " threads each\n";
+#else
+        std::cerr << "ERROR: Cannot start workers on this platform, use remote workers.\n";
+        return false;
+#endif
+    }
+    else
+        std::cout << "Waiting for " << options.nWorkers << " workers on port " << port << "\n";
+
+    // runs of consecutive tiles, so a worker's run is a compact region of the
+    // Hilbert curve; small enough that the last runs still balance the load
+    size_t runLength = Clamp(tiles.size() / (16 * options.nWorkers), 1, 64);
+    std::deque<std::vector<Tile>> pending;
+    for (size_t i = 0; i < tiles.size(); i += runLength)
+        pending.emplace_back(tiles.begin() + i, tiles.begin() + std::min(i + runLength, tiles.size()));
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t remaining = tiles.size();
+    ProgressReporter progress((int)tiles.size(), options.nWorkers);
+
+    auto serve = [&](Socket connection, int worker) {
+        uint32_t type;
+        std::vector<uint8_t> payload;
+        WorkerHello hello;
+        if (!connection.RecvMessage(&type, &payload, sizeof(hello)) || type != HelloMessage ||
+            payload.size() != sizeof(hello))
+            return;
+        memcpy(&hello, payload.data(), sizeof(hello));
+        WorkerHello expected(options.seed, film->width, film->height, spp, options.adaptive);
+        if (hello.width != expected.width || hello.height != expected.height || hello.spp != expected.spp ||
+            hello.seed != expected.seed || hello.minSpp != expected.minSpp ||
+            hello.maxRelativeError != expected.maxRelativeError) {
+            std::cerr << "ERROR: Worker renders " << hello.width << "x" << hello.height << " at " << hello.spp
+                      << " spp with seed " << hello.seed << " (adaptive " << hello.minSpp << ", " << hello.maxRelativeError
+                      << "), expected " << film->width << "x" << film->height << " at " << spp << " spp with seed "
+                      << options.seed << " (adaptive " << expected.minSpp << ", " << expected.maxRelativeError << ").\n";
+            connection.SendMessage(DoneMessage, nullptr, 0);
+            return;
+        }
+
+        std::vector<FilmPixel> tilePixels;
+        for (;;) {
+            std::vector<Tile> run;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&]() { return remaining == 0 || !pending.empty(); });
+                if (remaining == 0) break;
+                run = std::move(pending.front());
+                pending.pop_front();
+            }
+
+            std::vector<uint8_t> job(sizeof(int32_t) + run.size() * sizeof(Tile));
+            int32_t sampleEnd = spp;
+            memcpy(job.data(), &sampleEnd, sizeof(sampleEnd));
+            memcpy(job.data() + sizeof(sampleEnd), run.data(), run.size() * sizeof(Tile));
+            size_t expected = 0;
+            for (const Tile &tile : run) expected += (size_t)tile.Width() * tile.Height() * sizeof(FilmPixel);
+
+            if (!connection.SendMessage(JobMessage, job) || !connection.RecvMessage(&type, &payload, expected) ||
+                type != PixelsMessage || payload.size() != expected) {
+                std::cerr << "ERROR: Lost worker " << worker << ", its tiles go to the others.\n";
+                std::lock_guard<std::mutex> lock(mutex);
+                pending.push_front(std::move(run));
+                changed.notify_all();
+                return;
+            }
+
+            const uint8_t *p = payload.data();
+            for (const Tile &tile : run) {
+                tilePixels.resize((size_t)tile.Width() * tile.Height());
+                memcpy(tilePixels.data(), p, tilePixels.size() * sizeof(FilmPixel));
+                p += tilePixels.size() * sizeof(FilmPixel);
+                film->StoreTile(tile, tilePixels);
+                uint64_t samples = 0;
+                for (const FilmPixel &pixel : tilePixels) samples += pixel.variance.Count();
+                progress.TileDone(worker, samples, 0);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            remaining -= run.size();
+            changed.notify_all();
+        }
+        connection.SendMessage(DoneMessage, nullptr, 0);
+    };
+
+    auto finished = [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return remaining == 0;
+    };
+    // spawned workers that exited, without them nobody may be left to connect
+    size_t exited = 0;
+    auto reap = [&]() {
+#ifdef HAVE_SPAWN
+        for (int &pid : children)
+            if (pid > 0 && waitpid(pid, nullptr, WNOHANG) == pid) {
+                pid = -1;
+                ++exited;
+            }
+#endif
+    };
+
+    std::vector<std::thread> connections;
+    while ((int)connections.size() < options.nWorkers && !finished()) {
+        reap();
+        if (!children.empty() && exited == children.size()) break;
+        if (!listener.WaitReadable(0.5)) continue;
+        Socket connection = listener.Accept();
+        if (connection.Valid())
+            connections.emplace_back(serve, std::move(connection), (int)connections.size());
+    }
+    for (std::thread &connection : connections) connection.join();
+    progress.Done();
+
+#ifdef HAVE_SPAWN
+    for (int pid : children)
+        if (pid > 0) waitpid(pid, nullptr, 0);
+#endif
+    if (!finished()) {
+        std::cerr << "ERROR: Workers gave out with " << remaining << " tiles left.\n";
+        return false;
+    }
+    return true;
+}
+
+bool RunWorker(const std::string &address, Film *film, int spp, uint64_t seed, const AdaptiveSettings &adaptive,
+               const TileRenderFunc &render) {
+    std::string host;
+    int port;
+    if (!ParseAddress(address, &host, &port)) {
+        std::cerr << "ERROR: Expected host:port, got '" << address << "'.\n";
+        return false;
+    }
+    Socket connection = Socket::Connect(host, port);
+    if (!connection.Valid()) return false;
+
+    WorkerHello hello(seed, film->width, film->height, spp, adaptive);
+    if (!connection.SendMessage(HelloMessage, &hello, sizeof(hello))) return false;
+
+    uint32_t type;
+    std::vector<uint8_t> payload, pixels;
+    std::vector<FilmPixel> tilePixels;
+    // no run can hold more tiles than the film has pixels
+    uint64_t maxJob = sizeof(int32_t) + (uint64_t)film->width * film->height * sizeof(Tile);
+    while (connection.RecvMessage(&type, &payload, maxJob)) {
+        if (type == DoneMessage) return true;
+        if (type != JobMessage || payload.size() < sizeof(int32_t) ||
+            (payload.size() - sizeof(int32_t)) % sizeof(Tile) != 0)
+            break;
+
+        int32_t sampleEnd;
+        memcpy(&sampleEnd, payload.data(), sizeof(sampleEnd));
+        std::vector<Tile> run((payload.size() - sizeof(sampleEnd)) / sizeof(Tile));
+        memcpy(run.data(), payload.data() + sizeof(sampleEnd), run.size() * sizeof(Tile));
+        // the film indexes pixels with these bounds unchecked
+        bool valid = sampleEnd > 0 && sampleEnd <= spp;
+        for (const Tile &tile : run)
+            valid &= tile.x0 >= 0 && tile.x0 < tile.x1 && tile.x1 <= film->width &&
+                     tile.y0 >= 0 && tile.y0 < tile.y1 && tile.y1 <= film->height;
+        if (!valid) {
+            std::cerr << "ERROR: The coordinator sent a job that does not fit the " << film->width << "x"
+                      << film->height << " film at " << spp << " spp.\n";
+            return false;
+        }
+        render(run, sampleEnd);
+
+        pixels.clear();
+        for (const Tile &tile : run) {
+            film->CopyTile(tile, &tilePixels);
+            const uint8_t *p = (const uint8_t *)tilePixels.data();
+            pixels.insert(pixels.end(), p, p + tilePixels.size() * sizeof(FilmPixel));
+        }
+        if (!connection.SendMessage(PixelsMessage, pixels)) break;
+    }
+    std::cerr << "ERROR: Lost the connection to the coordinator.\n";
+    return false;
+}
@@ -0,0 +1,39 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include "film.h"
+
+#include <functional>
+#include <string>
+
+/*
+distributed rendering of one frame. A coordinator hands out runs of
+consecutive tiles to worker processes over TCP and stores the pixels they
+send back in its film. Workers build the same scene and render a tile
+exactly as a local render thread would; samplers are seeded per pixel, so
+the image does not depend on how tiles were spread over the workers, and a
+run a worker fails on goes back to the others.
+*/
+
+// Renders tiles into the film up to sampleEnd samples per pixel
+typedef std::function<void(const std::vector<Tile> &tiles, int sampleEnd)> TileRenderFunc;
+
+struct CoordinatorOptions {
+    int nWorkers = 1;
+    int port = 0;              // 0 picks a free port
+    std::string program;       // executable to spawn local workers with; empty waits for remote ones
+    int workerThreads = 0;     // --threads of spawned workers, 0 shares the processors out
+    uint64_t seed = 0;         // workers must render with the same seed
+    AdaptiveSettings adaptive; // and the same adaptive sampling
+    std::string sampler = "sobol"; // sampler of spawned workers
+};
+
+// Renders tiles with workers until every one is done; false if the workers
+// gave out before that
+bool RunCoordinator(Film *film, const std::vector<Tile> &tiles, int spp, const CoordinatorOptions &options);
+
+// Serves the coordinator at address ("host:port") until it has no work left
+bool RunWorker(const std::string &address, Film *film, int spp, uint64_t seed, const AdaptiveSettings &adaptive,
+               const TileRenderFunc &render);
+
+#endif
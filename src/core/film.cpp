@@ -0,0 +1,137 @@
+#include "film.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<FilmPixel>::value, "checkpoints store FilmPixels as raw bytes");
+
+// checkpoints are only read back by the same build, like the distributed protocol
+struct CheckpointHeader {
+    char magic[8];
+    uint64_t seed, jobKey;
+    int32_t version, width, height, spp, pixelSize;
+};
+
+static const char CheckpointMagic[8] = {'R', 'C', 'K', 'P', 'T', 0, 0, 0};
+static const int CheckpointVersion = 2;
+
+void Film::CopyTile(const Tile &tile, std::vector<FilmPixel> *tilePixels) const {
+    tilePixels->resize((size_t)tile.Width() * tile.Height());
+    for (int y = tile.y0; y < tile.y1; ++y)
+        std::copy(&Pixel(tile.x0, y), &Pixel(tile.x0, y) + tile.Width(),
+                  tilePixels->begin() + (size_t)(y - tile.y0) * tile.Width());
+}
+
+void Film::StoreTile(const Tile &tile, const std::vector<FilmPixel> &tilePixels) {
+    for (int y = tile.y0; y < tile.y1; ++y)
+        std::copy(tilePixels.begin() + (size_t)(y - tile.y0) * tile.Width(),
+                  tilePixels.begin() + (size_t)(y - tile.y0 + 1) * tile.Width(), &Pixel(tile.x0, y));
+}
+
+uint64_t Film::SampleCount() const {
+    uint64_t n = 0;
+    for (const FilmPixel &pixel : pixels) n += pixel.variance.Count();
+    return n;
+}
+
+double Film::MeanRelativeError() const {
+    double sum = 0;
+    for (const FilmPixel &pixel : pixels) sum += std::min(pixel.variance.RelativeError(), 1.0);
+    return sum / pixels.size();
+}
+
+uint64_t Film::Hash() const {
+    uint64_t h = 0;
+    for (const FilmPixel &pixel : pixels) {
+        h = MixBits(h ^ ((uint64_t)FloatToBits(pixel.sum.r) << 32 | FloatToBits(pixel.sum.g)));
+        h = MixBits(h ^ ((uint64_t)FloatToBits(pixel.sum.b) << 32 | (uint32_t)pixel.variance.Count()));
+    }
+    return h;
+}
+
+bool Film::WriteCheckpoint(const std::string &filename, int spp, uint64_t seed, uint64_t jobKey) const {
+    CheckpointHeader header = {};
+    memcpy(header.magic, CheckpointMagic, sizeof(CheckpointMagic));
+    header.seed = seed;
+    header.jobKey = jobKey;
+    header.version = CheckpointVersion;
+    header.width = width;
+    header.height = height;
+    header.spp = spp;
+    header.pixelSize = sizeof(FilmPixel);
+
+    std::string tmpName = filename + ".tmp";
+    FILE *f = fopen(tmpName.c_str(), "wb");
+    if (!f) {
+        std::cerr << "ERROR: Could not write '" << tmpName << "'.\n";
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(pixels.data(), sizeof(FilmPixel), pixels.size(), f) == pixels.size();
+    ok = fclose(f) == 0 && ok;
+    if (!ok || std::rename(tmpName.c_str(), filename.c_str()) != 0) {
+        std::cerr << "ERROR: Could not write checkpoint '" << filename << "'.\n";
+        return false;
+    }
+    return true;
+}
+
+bool Film::ReadCheckpoint(const std::string &filename, int spp, uint64_t seed, uint64_t jobKey) {
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (!f) {
+        std::cerr << "ERROR: Could not open checkpoint '" << filename << "'.\n";
+        return false;
+    }
+    CheckpointHeader header;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+              !memcmp(header.magic, CheckpointMagic, sizeof(CheckpointMagic)) &&
+              header.version == CheckpointVersion && header.pixelSize == (int)sizeof(FilmPixel);
+    if (!ok)
+        std::cerr << "ERROR: '" << filename << "' is not a checkpoint of this renderer.\n";
+    else if (header.width != width || header.height != height || header.spp != spp || header.seed != seed) {
+        std::cerr << "ERROR: Checkpoint '" << filename << "' is of a " << header.width << "x" << header.height << " render at "
+                  << header.spp << " spp with seed " << header.seed << ", not " << width << "x" << height << " at " << spp
+                  << " spp with seed " << seed << ".\n";
+        ok = false;
+    }
+    else if (header.jobKey != jobKey) {
+        std::cerr << "ERROR: Checkpoint '" << filename << "' is of another scene, camera or sampling setup.\n";
+        ok = false;
+    }
+    std::vector<FilmPixel> stored(pixels.size());
+    if (ok && fread(stored.data(), sizeof(FilmPixel), stored.size(), f) != stored.size()) {
+        std::cerr << "ERROR: Checkpoint '" << filename << "' is truncated.\n";
+        ok = false;
+    }
+    fclose(f);
+    if (ok) pixels.swap(stored);
+    return ok;
+}
+
+bool Film::WritePPM(const std::string &filename) const {
+    std::string tmpName = filename + ".tmp";
+    FILE *f = fopen(tmpName.c_str(), "w");
+    if (!f) {
+        std::cerr << "ERROR: Could not write '" << tmpName << "'.\n";
+        return false;
+    }
+    fprintf(f, "P3\n%d %d\n%d\n", width, height, 255);
+    for (int y = height - 1; y >= 0; --y)
+        for (int x = 0; x < width; ++x) {
+            const FilmPixel &pixel = Pixel(x, y);
+            int n = pixel.variance.Count();
+            // Divide the color by the number of samples and gamma-correct for gamma=2.0.
+            float scale = n > 0 ? 1.f / n : 0.f;
+            fprintf(f, "%d %d %d ", static_cast<int>(256 * clamp(std::sqrt(scale * pixel.sum.r), 0.0, 0.999)),
+                        static_cast<int>(256 * clamp(std::sqrt(scale * pixel.sum.g), 0.0, 0.999)),
+                        static_cast<int>(256 * clamp(std::sqrt(scale * pixel.sum.b), 0.0, 0.999)));
+        }
+    fclose(f);
+    if (std::rename(tmpName.c_str(), filename.c_str()) != 0) {
+        std::cerr << "ERROR: Could not replace '" << filename << "'.\n";
+        return false;
+    }
+    return true;
+}
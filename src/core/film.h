@@ -0,0 +1,66 @@
+#ifndef FILM_H
+#define FILM_H
+
+#include "spectrum.h"
+#include "adaptive.h"
+#include "scheduler.h"
+
+#include <string>
+
+/*
+accumulated radiance of every pixel, kept across render passes so the
+image can be written at any point: each pixel is normalized by its own
+sample count, pixel (0, 0) is the bottom left as in camera::get_Ray
+*/
+
+struct FilmPixel {
+    Spectrum sum = 0.f;
+    PixelVariance variance;   // also counts the pixel's samples
+    bool converged = false;   // adaptive sampling is done with it
+
+    void AddSample(const Spectrum &L) {
+        sum += L;
+        variance.Add(L);
+    }
+};
+
+class Film {
+public:
+    Film(int width, int height) : width(width), height(height), pixels((size_t)width * height) {}
+
+    FilmPixel &Pixel(int x, int y) { return pixels[(size_t)y * width + x]; }
+    const FilmPixel &Pixel(int x, int y) const { return pixels[(size_t)y * width + x]; }
+
+    // Render threads work on a private copy of their tile, so neighbouring
+    // tiles never write to the same cache lines
+    void CopyTile(const Tile &tile, std::vector<FilmPixel> *tilePixels) const;
+    void StoreTile(const Tile &tile, const std::vector<FilmPixel> &tilePixels);
+
+    uint64_t SampleCount() const;
+    // Relative error of the pixel means, averaged over the image
+    double MeanRelativeError() const;
+    // Hash of every pixel's sum and sample count; equal only for bit-identical renders
+    uint64_t Hash() const;
+
+    // Every pixel's sum, sample count, variance and convergence, for resuming
+    // an interrupted render. Samplers need no state of their own: a pixel goes
+    // on at sample Count(), and a sample only depends on pixel, index and seed.
+    // Written like the image, through a temporary file. jobKey identifies
+    // everything else that shapes the image (scene, camera, sampling).
+    bool WriteCheckpoint(const std::string &filename, int spp, uint64_t seed, uint64_t jobKey) const;
+    // false, leaving the film alone, unless filename is a checkpoint of this
+    // film's size taken at the same spp, seed and jobKey
+    bool ReadCheckpoint(const std::string &filename, int spp, uint64_t seed, uint64_t jobKey);
+
+    // Gamma 2 corrected 8-bit PPM; written to a temporary file first and
+    // renamed over filename, so readers never see a partial image
+    bool WritePPM(const std::string &filename) const;
+
+public:
+    const int width, height;
+
+private:
+    std::vector<FilmPixel> pixels;
+};
+
+#endif
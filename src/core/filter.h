@@ -0,0 +1,135 @@
+#ifndef RENDERER_FILTER_H
+#define RENDERER_FILTER_H
+
+#include "object.h"
+#include "global_stb_image.h"
+
+#include <functional>
+
+/*
+intersection filters, attached to a primitive by wrapping it in a FilteredObject
+and run on candidate hits inside BVH traversal so rejected hits never reach the
+integrator
+*/
+
+// Runs on every candidate hit of a primitive inside traversal; returning false
+// rejects the hit and traversal carries on as if the primitive were not there.
+// Filters only get the raw hit and rebuild what they read, e.g. via HitUV()
+typedef std::function<bool(const Ray &ray, const RawHit &hit)> IntersectionFilter;
+
+// Leaf primitive plus its filter. Only wrapped primitives pay for the filter,
+// and hits report the wrapped primitive, so shading never sees the wrapper.
+// Wrap leaf primitives only: a rejected aggregate hit would hide the ones behind it.
+class FilteredObject : public Object
+{
+public:
+    FilteredObject(const Object *object, IntersectionFilter filter)
+        : Object(object->mediumRecord), object(object), filter(filter)
+    {
+        area = object->area;
+    }
+
+    virtual bool hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const override
+    {
+        Ray ray(r.o, r.d, t_max, r.time, r.medium);
+        ray.skipPassThrough = r.skipPassThrough;
+        return Intersect(ray, rec) && rec.t >= t_min;
+    }
+    virtual bool bounding_box(double time0, double time1, AABB &output_box) const override
+    {
+        return object->bounding_box(time0, time1, output_box);
+    }
+    virtual double pdf_value(const Point3f &o, const Vector3f &v) const override
+    {
+        return object->pdf_value(o, v);
+    }
+    virtual Vector3f random(const Vector3f &o, const Point2f &u) const override
+    {
+        return object->random(o, u);
+    }
+
+    // A rejected hit leaves ray and hit untouched
+    virtual bool IntersectHit(const Ray &ray, RawHit &hit) const override
+    {
+        float tMax = ray.tMax;
+        RawHit candidate;
+        if (!object->IntersectHit(ray, candidate)) return false;
+        if (!filter(ray, candidate)) {
+            ray.tMax = tMax;
+            return false;
+        }
+        hit = candidate;
+        return true;
+    }
+
+public:
+    const Object *object;   // not owned
+    IntersectionFilter filter;
+};
+
+// Material-less geometry (e.g. the emitting light quad) is only reported to
+// rays that look for emitters; shadow rays and indirect bounces step over it
+inline bool PassThroughFilter(const Ray &ray, const RawHit &hit)
+{
+    return !ray.skipPassThrough;
+}
+
+class AlphaMask
+{
+public:
+    AlphaMask(int width, int height, const std::vector<float> &texels)
+        : width(width), height(height), texels(texels) {}
+
+    // 8-bit grayscale cut-out image, black is fully transparent
+    AlphaMask(const std::string &filename)
+    {
+        int n;
+        unsigned char *data = stbi_load(filename.c_str(), &width, &height, &n, 1);
+        if (!data)
+        {
+            std::cerr << "ERROR: Could not load alpha mask '" << filename << "'.\n";
+            width = height = 1;
+            texels.assign(1, 1.f);
+            return;
+        }
+        texels.resize(width * height);
+        for (int i = 0; i < width * height; ++i)
+            texels[i] = data[i] / 255.f;
+        stbi_image_free(data);
+    }
+
+    // nearest texel, uv in [0, 1]^2 with v pointing up
+    float Evaluate(const Point2f &uv) const
+    {
+        int x = Clamp((int)(uv.x * width), 0, width - 1);
+        int y = Clamp((int)((1 - uv.y) * height), 0, height - 1);
+        return texels[y * width + x];
+    }
+
+private:
+    int width, height;
+    std::vector<float> texels;
+};
+
+// Uniform value in [0, 1) that only depends on the ray, so every query along
+// the same ray makes the same keep/reject decision for a partially opaque texel
+inline float HashFloat(const Ray &ray)
+{
+    uint64_t h = MixBits(((uint64_t)FloatToBits(ray.o.x) << 32) ^ FloatToBits(ray.o.y));
+    h = MixBits(h ^ ((uint64_t)FloatToBits(ray.o.z) << 32) ^ FloatToBits(ray.d.x));
+    h = MixBits(h ^ ((uint64_t)FloatToBits(ray.d.y) << 32) ^ FloatToBits(ray.d.z));
+    return (h >> 40) * 0x1p-24f;
+}
+
+// Alpha 0 rejects the hit, 1 keeps it, values in between keep it stochastically
+inline IntersectionFilter AlphaMaskFilter(std::shared_ptr<const AlphaMask> mask)
+{
+    return [mask](const Ray &ray, const RawHit &hit) {
+        float alpha = mask->Evaluate(hit.primitive->HitUV(hit));
+        if (alpha >= 1) return true;
+        if (alpha <= 0) return false;
+        return HashFloat(ray) < alpha;
+    };
+}
+
+#endif
@@ -11,6 +11,8 @@
 #include <omp.h>
 #include <chrono>
 
+#include "rng.h"
+
 // Class Declarations
 
 class Transform;
@@ -53,8 +55,7 @@ const float Inv4Pi = 0.07957747154594766788;
 const float PiOver2 = 1.57079632679489661923;
 const float PiOver4 = 0.78539816339744830961;
 const float ShadowEpsilon = 0.0001f;
-
-static omp_lock_t lock;
+static constexpr float MachineEpsilon = std::numeric_limits<float>::epsilon() * 0.5f;
 
 // Utility Functions
 
@@ -65,6 +66,45 @@ inline T Clamp(T val, U low, V high) {
     else return val;
 }
 
+// Conservative bound on the relative error of n chained floating-point operations
+inline constexpr float gamma(int n) {
+    return (n * MachineEpsilon) / (1 - n * MachineEpsilon);
+}
+
+inline uint32_t FloatToBits(float f) {
+    uint32_t ui;
+    memcpy(&ui, &f, sizeof(float));
+    return ui;
+}
+
+inline float BitsToFloat(uint32_t ui) {
+    float f;
+    memcpy(&f, &ui, sizeof(uint32_t));
+    return f;
+}
+
+inline float NextFloatUp(float v) {
+    if (std::isinf(v) && v > 0.) return v;
+    if (v == -0.f) v = 0.f;
+    uint32_t ui = FloatToBits(v);
+    if (v >= 0) ++ui;
+    else --ui;
+    return BitsToFloat(ui);
+}
+
+inline float NextFloatDown(float v) {
+    if (std::isinf(v) && v < 0.) return v;
+    if (v == 0.f) v = -0.f;
+    uint32_t ui = FloatToBits(v);
+    if (v > 0) --ui;
+    else ++ui;
+    return BitsToFloat(ui);
+}
+
+inline bool IsPowerOf2(int v) {
+    return v > 0 && (v & (v - 1)) == 0;
+}
+
 inline float Lerp(float t, float v1, float v2) {
     return (1 - t) * v1 + t * v2;
 }
@@ -74,10 +114,25 @@ inline double degrees_to_radians(double degrees)
     return degrees * PI / 180.0;
 }
 
+// Generator behind random_double, one per thread so it never races. Only for
+// scene construction, rendering draws from its Sampler.
+inline RNG &ThreadRNG()
+{
+    static thread_local RNG rng;
+    return rng;
+}
+
+// Restarts this thread's random_double sequence, so a scene built after it
+// is the same however many were built before and on whichever thread
+inline void SeedRandom(uint64_t seed)
+{
+    ThreadRNG().SetSequence(seed);
+}
+
 inline double random_double()
 {
     // Returns a random real in [0,1).
-    return rand() / (RAND_MAX + 1.0);
+    return ThreadRNG().UniformUInt32() * 0x1p-32;
 }
 
 inline double random_double(double min, double max)
@@ -113,19 +168,4 @@ inline float PowerHeuristic(int nf, float fPdf, int ng, float gPdf) {
     return (f * f) / (f * f + g * g);
 }
 
-inline void UpdateProgress(float progress)
-{
-    int barWidth = 70;
-
-    std::cout << "[";
-    int pos = barWidth * progress;
-    for (int i = 0; i < barWidth; ++i) {
-        if (i < pos) std::cout << "=";
-        else if (i == pos) std::cout << ">";
-        else std::cout << " ";
-    }
-    std::cout << "] " << int(progress * 100.0) << " %\r";
-    std::cout.flush();
-};
-
 #endif
\ No newline at end of file
@@ -14,10 +14,10 @@ class ObjectList : public Object
 {
 public:
     ObjectList() : Object(nullptr){}
-    ObjectList(shared_ptr<Object> object) : Object(nullptr){ add(object); }
+    ObjectList(Object *object) : Object(nullptr){ add(object); }
 
     void clear() { objects.clear(); }
-    void add(shared_ptr<Object> object) { objects.push_back(object); }
+    void add(Object *object) { objects.push_back(object); }
 
     virtual bool hit(
         const Ray &r, double t_min, double t_max, HitRecord &rec) const override;
@@ -27,30 +27,25 @@ public:
 
     virtual double pdf_value(const Point3f &o, const Vector3f &v) const override;
 
-    virtual Vector3f random(const Vector3f &o) const override;
-    bool Intersect(const Ray &ray, HitRecord &isect) const ;
+    virtual Vector3f random(const Vector3f &o, const Point2f &u) const override;
+    virtual bool IntersectHit(const Ray &ray, RawHit &hit) const override;
 
 public:
-    std::vector<shared_ptr<Object>> objects;
+    // not owned, usually in the scene's arena
+    std::vector<Object *> objects;
 };
 
-bool ObjectList::Intersect(const Ray &ray, HitRecord &isect) const {
+bool ObjectList::IntersectHit(const Ray &ray, RawHit &hit) const {
     bool hit_anything = false;
-    auto closest_so_far = INF;
 
+    // every hit shortens ray.tMax, so the last one reported is the closest
     for (const auto &object : objects)
     {
-        if (object->Intersect(ray, isect))
-        {
+        if (object->IntersectHit(ray, hit))
             hit_anything = true;
-            if (closest_so_far > isect.t) {
-                closest_so_far = isect.t;
-            }
-        }
     }
 
     return hit_anything;
-    return false;
 }
 
 bool ObjectList::hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const
@@ -102,10 +97,13 @@ double ObjectList::pdf_value(const Point3f &o, const Vector3f &v) const
     return sum;
 }
 
-Vector3f ObjectList::random(const Vector3f &o) const
+Vector3f ObjectList::random(const Vector3f &o, const Point2f &u) const
 {
+    // u.x picks the object, then is stretched back to [0, 1) for it
     auto int_size = static_cast<int>(objects.size());
-    return objects[random_int(0, int_size - 1)]->random(o);
+    int index = std::min((int)(u.x * int_size), int_size - 1);
+    Point2f uRemapped(std::min(u.x * int_size - index, FloatOneMinusEpsilon), u.y);
+    return objects[index]->random(o, uRemapped);
 }
 
 #endif
\ No newline at end of file
@@ -4,7 +4,7 @@ Spectrum UniformSampleOneLight(const Ray &r, const HitRecord &it, const Scene &s
     int nLights = int(scene.lights.size());
     if (nLights == 0) return Spectrum(0.f);
     int lightNum = std::min((int)(sampler.Next1D() * nLights), nLights - 1);
-    const std::shared_ptr<Light> &light = scene.lights[lightNum];
+    const Light *light = scene.lights[lightNum];
     return EstimateDirect(r, it, *light, scene, sampler, handleMedia) * (float)nLights;
 }
 
@@ -24,7 +24,7 @@ Spectrum EstimateDirect(const Ray &r, const HitRecord &it, const Light &light, c
         Spectrum f;
         if (it.IsSurface() && it.mat_ptr) {
             const HitRecord &isect = (const HitRecord &)it; 
-            f = isect.bsdf->f(isect.wo, wi, bsdfFlags) * AbsDot(wi, isect.normal);
+            f = isect.bsdf->f(isect.wo, wi, bsdfFlags) * AbsDot(wi, isect.shadingNormal);
             scatteringPdf = isect.bsdf->Pdf(isect.wo, wi, bsdfFlags); 
         }
         else {
@@ -62,7 +62,7 @@ Spectrum EstimateDirect(const Ray &r, const HitRecord &it, const Light &light, c
                 BxDFType sampledType;
                 const HitRecord &isect = (const HitRecord &)it;
                 f = isect.bsdf->Sample_f(isect.wo, &wi, sampler.Next2D(), &scatteringPdf, bsdfFlags, &sampledType);
-                f *= AbsDot(wi, isect.normal);
+                f *= AbsDot(wi, isect.shadingNormal);
                 sampledSpecular = (sampledType & BSDF_SPECULAR);
             }
             else {
@@ -81,7 +81,7 @@ Spectrum EstimateDirect(const Ray &r, const HitRecord &it, const Light &light, c
                 }
 
                 HitRecord lightIsect;
-                Ray ray = Ray(it.p, wi, INF, 0.f, r.medium);
+                Ray ray = it.SpawnRay(wi, r.medium);
                 Spectrum Tr(1.f);
                 bool foundSurfaceInteraction = handleMedia ? scene.IntersectTr(ray, sampler, lightIsect, &Tr)
                                                            : scene.Intersect(ray, lightIsect);
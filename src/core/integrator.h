@@ -16,7 +16,7 @@ public:
                       std::shared_ptr<Sampler> sampler)
                     : camera(camera), sampler(sampler) {}
     
-    virtual Spectrum Li(const Ray &ray, const Scene &scene, Sampler &sampler) const = 0;
+    virtual Spectrum Li(const Ray &ray, const Scene &scene, Sampler &sampler, MemoryArena &arena) const = 0;
 public:
     std::shared_ptr<Camera> camera;
     std::shared_ptr<Sampler> sampler;
@@ -7,12 +7,15 @@ Spectrum Light::Le(const Ray &ray) const {
 bool VisibilityTester::Unoccluded(const Scene &scene) const {
     Point3f origin = p0;
     Vector3f direction = p1 - p0;
-    HitRecord isect;
-    return !scene.Intersect(Ray(origin, direction, 1 - ShadowEpsilon), isect);
+    RawHit hit;
+    Ray ray(origin, direction, 1 - ShadowEpsilon);
+    ray.skipPassThrough = true;
+    return !scene.IntersectHit(ray, hit);
 }
 
 Spectrum VisibilityTester::Tr(const Ray &r, const Scene &scene, Sampler &sampler) const {
     Ray ray(p0, p1 - p0, 1.f - ShadowEpsilon, 0.f, r.medium);
+    ray.skipPassThrough = true;
     Spectrum Tr(1.f);
     while (true) {
         HitRecord isect;
@@ -28,8 +31,8 @@ Spectrum VisibilityTester::Tr(const Ray &r, const Scene &scene, Sampler &sampler
         if (!hitSurface)
             break;
 
-        Vector3f dir = p1 - isect.p;
-        ray = Ray(isect.p + dir * 0.0001, dir, 1.f - ShadowEpsilon, 0.f, r.medium);
+        ray = isect.SpawnRayTo(p1, r.medium);
+        ray.skipPassThrough = true;
     }
 
     return Tr;
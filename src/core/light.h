@@ -27,6 +27,10 @@ public:
 struct VisibilityTester {
     VisibilityTester() {}
     VisibilityTester(const Point3f &p0, const Point3f &p1) : p0(p0), p1(p1) {}
+    // Both endpoints are pushed off their surfaces by their error bounds
+    VisibilityTester(const HitRecord &i0, const HitRecord &i1)
+        : p0(OffsetRayOrigin(i0.p, i0.pError, i0.normal, i1.p - i0.p)),
+          p1(OffsetRayOrigin(i1.p, i1.pError, i1.normal, i0.p - i1.p)) {}
     bool Unoccluded(const Scene &scene) const;
     Spectrum Tr(const Ray &ray, const Scene &scene, Sampler &sampler) const;
     Point3f p0, p1;
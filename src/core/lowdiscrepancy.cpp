@@ -0,0 +1,49 @@
+#include "lowdiscrepancy.h"
+
+static std::array<int, PrimeTableSize> FirstPrimes() {
+    std::array<int, PrimeTableSize> primes{};
+    int n = 0;
+    for (int candidate = 2; n < PrimeTableSize; ++candidate) {
+        bool isPrime = true;
+        for (int i = 0; i < n && primes[i] * primes[i] <= candidate; ++i)
+            if (candidate % primes[i] == 0) {
+                isPrime = false;
+                break;
+            }
+        if (isPrime) primes[n++] = candidate;
+    }
+    return primes;
+}
+
+static std::array<std::array<uint32_t, SobolMatrixSize>, 2> FirstSobolMatrices() {
+    std::array<std::array<uint32_t, SobolMatrixSize>, 2> matrices{};
+    // dimension 0 is the van der Corput sequence; dimension 1 has the primitive
+    // polynomial x + 1, so its direction numbers follow m_k = 2 m_(k-1) ^ m_(k-1)
+    uint32_t m = 1;
+    for (int k = 0; k < SobolMatrixSize; ++k) {
+        matrices[0][k] = 1u << (31 - k);
+        matrices[1][k] = m << (31 - k);
+        m = (m << 1) ^ m;
+    }
+    return matrices;
+}
+
+const std::array<int, PrimeTableSize> Primes = FirstPrimes();
+const std::array<std::array<uint32_t, SobolMatrixSize>, 2> SobolMatrices = FirstSobolMatrices();
+
+float OwenScrambledRadicalInverse(int baseIndex, uint64_t a, uint32_t hash) {
+    int base = Primes[baseIndex];
+    float invBase = 1.f / base, invBaseM = 1;
+    uint64_t reversedDigits = 0;
+    // keeps going past the last nonzero digit of a, the zero digits get scrambled too
+    while (1 - (base - 1) * invBaseM < 1) {
+        uint64_t next = a / base;
+        int digitValue = (int)(a - next * base);
+        uint32_t digitHash = (uint32_t)MixBits(hash ^ reversedDigits);
+        digitValue = PermutationElement(digitValue, base, digitHash);
+        reversedDigits = reversedDigits * base + digitValue;
+        invBaseM *= invBase;
+        a = next;
+    }
+    return std::min(invBaseM * reversedDigits, FloatOneMinusEpsilon);
+}
@@ -0,0 +1,84 @@
+#ifndef LOWDISCREPANCY_H
+#define LOWDISCREPANCY_H
+
+#include "rng.h"
+
+#include <array>
+
+/*
+building blocks of the low-discrepancy samplers: randomized radical inverses
+(Halton), Owen-scrambled Sobol points and hashed permutations (Kensler 2013)
+*/
+
+static constexpr int PrimeTableSize = 1000;
+extern const std::array<int, PrimeTableSize> Primes;
+
+static constexpr int SobolMatrixSize = 32;
+// Generator matrices of the first two Sobol dimensions, one column per word
+extern const std::array<std::array<uint32_t, SobolMatrixSize>, 2> SobolMatrices;
+
+inline uint32_t ReverseBits32(uint32_t n) {
+    n = (n << 16) | (n >> 16);
+    n = ((n & 0x00ff00ff) << 8) | ((n & 0xff00ff00) >> 8);
+    n = ((n & 0x0f0f0f0f) << 4) | ((n & 0xf0f0f0f0) >> 4);
+    n = ((n & 0x33333333) << 2) | ((n & 0xcccccccc) >> 2);
+    n = ((n & 0x55555555) << 1) | ((n & 0xaaaaaaaa) >> 1);
+    return n;
+}
+
+// Element i of a random permutation of [0, l) selected by p
+inline int PermutationElement(uint32_t i, uint32_t l, uint32_t p) {
+    uint32_t w = l - 1;
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+    do {
+        i ^= p;
+        i *= 0xe170893d;
+        i ^= p >> 16;
+        i ^= (i & w) >> 4;
+        i ^= p >> 8;
+        i *= 0x0929eb3f;
+        i ^= p >> 23;
+        i ^= (i & w) >> 1;
+        i *= 1 | p >> 27;
+        i *= 0x6935fa69;
+        i ^= (i & w) >> 11;
+        i *= 0x74dcb303;
+        i ^= (i & w) >> 2;
+        i *= 0x9e501cc3;
+        i ^= (i & w) >> 2;
+        i *= 0xc860a3df;
+        i &= w;
+        i ^= i >> 5;
+    } while (i >= l);
+    return (i + p) % l;
+}
+
+// Hash-based approximation of a nested uniform (Owen) scramble of a 0.32 fixed point value
+inline uint32_t FastOwenScramble(uint32_t v, uint32_t seed) {
+    v = ReverseBits32(v);
+    v ^= v * 0x3d20adea;
+    v += seed;
+    v *= (seed >> 16) | 1;
+    v ^= v * 0x05526c56;
+    v ^= v * 0x53a22864;
+    return ReverseBits32(v);
+}
+
+// Point a of Sobol dimension 0 or 1, Owen-scrambled with seed
+inline float SobolSample(uint32_t a, int dimension, uint32_t seed) {
+    uint32_t v = 0;
+    for (int i = 0; a != 0; a >>= 1, ++i)
+        if (a & 1) v ^= SobolMatrices[dimension][i];
+    v = FastOwenScramble(v, seed);
+    return std::min(v * 0x1p-32f, FloatOneMinusEpsilon);
+}
+
+// Radical inverse of a in base Primes[baseIndex], every digit permuted by a
+// hash of the digits before it, i.e. an Owen scramble of the Halton point
+float OwenScrambledRadicalInverse(int baseIndex, uint64_t a, uint32_t hash);
+
+#endif
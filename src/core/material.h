@@ -4,11 +4,13 @@
 #include "spectrum.h"
 #include "bsdf.h"
 #include "record.h"
+#include "memory.h"
 
 class Material {
 public:
     virtual ~Material() {}
-    virtual void ComputeScatteringFunctions(HitRecord *si, TransportMode mode) const = 0;
+    // Shading objects are allocated from arena, which outlives the path sample
+    virtual void ComputeScatteringFunctions(HitRecord *si, MemoryArena &arena, TransportMode mode) const = 0;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "memory.h"
+#include "allocstats.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+static constexpr size_t L1CacheLineSize = 64;
+
+void *AllocAligned(size_t size) {
+    // aligned_alloc wants the size to be a multiple of the alignment
+    size = (size + L1CacheLineSize - 1) & ~(L1CacheLineSize - 1);
+    CountAllocation();
+    return aligned_alloc(L1CacheLineSize, size);
+}
+
+void FreeAligned(void *ptr) {
+    if (!ptr) return;
+    free(ptr);
+}
+
+MemoryArena::~MemoryArena() {
+    FreeAligned(currentBlock);
+    for (auto &block : usedBlocks) FreeAligned(block.second);
+    for (auto &block : availableBlocks) FreeAligned(block.second);
+}
+
+void MemoryArena::NextBlock(size_t nBytes) {
+    // retire the current block, then reuse the first free one that fits
+    if (currentBlock) {
+        usedBlocks.push_back(std::make_pair(currentAllocSize, currentBlock));
+        currentBlock = nullptr;
+        currentAllocSize = 0;
+    }
+    for (auto iter = availableBlocks.begin(); iter != availableBlocks.end(); ++iter) {
+        if (iter->first >= nBytes) {
+            currentAllocSize = iter->first;
+            currentBlock = iter->second;
+            availableBlocks.erase(iter);
+            break;
+        }
+    }
+    if (!currentBlock) {
+        currentAllocSize = std::max(nBytes, blockSize);
+        currentBlock = (uint8_t *)AllocAligned(currentAllocSize);
+    }
+    currentBlockPos = 0;
+}
+
+size_t MemoryArena::TotalAllocated() const {
+    size_t total = currentAllocSize;
+    for (const auto &block : usedBlocks) total += block.first;
+    for (const auto &block : availableBlocks) total += block.first;
+    return total;
+}
+
+SceneArena::~SceneArena() {
+    // later objects may refer to earlier ones, never the other way round
+    for (auto d = destructors.rbegin(); d != destructors.rend(); ++d) d->destroy(d->object);
+    for (const Chunk &chunk : chunks) {
+#ifdef __linux__
+        if (chunk.mapped) {
+            munmap(chunk.ptr, chunk.size);
+            continue;
+        }
+#endif
+        FreeAligned(chunk.ptr);
+    }
+}
+
+void SceneArena::NextChunk(size_t minBytes) {
+    size_t size = std::max(chunkSize, minBytes);
+    size = (size + HugePageSize - 1) & ~(HugePageSize - 1);
+
+    Chunk chunk{nullptr, size, false};
+#ifdef __linux__
+    // over-map by one huge page so the chunk can start on a huge page boundary
+    void *ptr = mmap(nullptr, size + HugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr != MAP_FAILED) {
+        uintptr_t start = (uintptr_t)ptr, aligned = (start + HugePageSize - 1) & ~(uintptr_t)(HugePageSize - 1);
+        if (aligned > start) munmap(ptr, aligned - start);
+        if (aligned + size < start + size + HugePageSize)
+            munmap((void *)(aligned + size), start + size + HugePageSize - (aligned + size));
+#ifdef MADV_HUGEPAGE
+        madvise((void *)aligned, size, MADV_HUGEPAGE);
+#endif
+        chunk.ptr = (uint8_t *)aligned;
+        chunk.mapped = true;
+    }
+#endif
+    if (!chunk.ptr) chunk.ptr = (uint8_t *)AllocAligned(size);
+
+    chunks.push_back(chunk);
+    currentChunk = chunk.ptr;
+    currentSize = size;
+    currentPos = 0;
+}
+
+size_t SceneArena::BytesReserved() const {
+    size_t total = 0;
+    for (const Chunk &chunk : chunks) total += chunk.size;
+    return total;
+}
+
+size_t SceneArena::HugePageChunks() const {
+    size_t n = 0;
+    for (const Chunk &chunk : chunks) n += chunk.mapped;
+    return n;
+}
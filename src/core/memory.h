@@ -0,0 +1,170 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include "global.h"
+
+#include <cstddef>
+#include <list>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+bump allocator for short-lived shading objects (BSDFs, BxDFs, Fresnel terms,
+microfacet distributions). One arena per render thread, reset after every
+path sample; destructors of arena objects are never run.
+*/
+
+#define ARENA_ALLOC(arena, Type) new ((arena).Alloc(sizeof(Type))) Type
+
+void *AllocAligned(size_t size);
+void FreeAligned(void *ptr);
+
+class MemoryArena {
+public:
+    MemoryArena(size_t blockSize = 262144) : blockSize(blockSize) {}
+    MemoryArena(const MemoryArena &) = delete;
+    MemoryArena &operator=(const MemoryArena &) = delete;
+    ~MemoryArena();
+
+    void *Alloc(size_t nBytes) {
+        // keep every allocation 16-byte aligned
+        nBytes = (nBytes + 15) & ~(size_t)15;
+        if (currentBlockPos + nBytes > currentAllocSize)
+            NextBlock(nBytes);
+        void *ret = currentBlock + currentBlockPos;
+        currentBlockPos += nBytes;
+        return ret;
+    }
+
+    template <typename T>
+    T *Alloc(size_t n = 1, bool runConstructor = true) {
+        T *ret = (T *)Alloc(n * sizeof(T));
+        if (runConstructor)
+            for (size_t i = 0; i < n; ++i) new (&ret[i]) T();
+        return ret;
+    }
+
+    // Makes all memory available again; blocks are kept for reuse
+    void Reset() {
+        currentBlockPos = 0;
+        availableBlocks.splice(availableBlocks.begin(), usedBlocks);
+    }
+
+    size_t TotalAllocated() const;
+
+private:
+    void NextBlock(size_t nBytes);
+
+    const size_t blockSize;
+    size_t currentBlockPos = 0, currentAllocSize = 0;
+    uint8_t *currentBlock = nullptr;
+    std::list<std::pair<size_t, uint8_t *>> usedBlocks, availableBlocks;
+};
+
+/*
+arena for what the scene owns (primitives, BVH nodes and leaves, mesh
+attributes, materials, lights). Memory comes in large chunks, backed by
+transparent huge pages where the OS supports them, so geometry built together
+shares few pages. Objects are placed with New() and refer to each other through
+plain pointers. The bulk of the scene (triangles, BVH nodes and leaves) is
+trivially destructible, so releasing the chunks is all its teardown; the few
+objects that do own something (materials, media, filtered or displaced
+primitives) have their destructors run by the arena just before. Not
+thread-safe, meant for scene construction only.
+*/
+class SceneArena {
+public:
+    static constexpr size_t HugePageSize = 2 << 20;
+
+    SceneArena(size_t chunkSize = HugePageSize) : chunkSize(chunkSize) {}
+    SceneArena(const SceneArena &) = delete;
+    SceneArena &operator=(const SceneArena &) = delete;
+    ~SceneArena();
+
+    void *Alloc(size_t nBytes, size_t align = alignof(std::max_align_t)) {
+        size_t pos = (currentPos + align - 1) & ~(align - 1);
+        if (!currentChunk || pos + nBytes > currentSize) {
+            NextChunk(nBytes + align);
+            pos = (currentPos + align - 1) & ~(align - 1);
+        }
+        currentPos = pos + nBytes;
+        bytesUsed += nBytes;
+        return currentChunk + pos;
+    }
+
+    // T placed in the arena, destroyed with it; trivially destructible types cost
+    // nothing at teardown, others have their destructor queued
+    template <typename T, typename... Args>
+    T *New(Args &&... args) {
+        T *object = new (Alloc(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value)
+            destructors.push_back(Destructor{[](void *p) { ((T *)p)->~T(); }, object});
+        return object;
+    }
+    // n default-constructed T, for arrays of trivially destructible types
+    template <typename T>
+    T *NewArray(size_t n) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena arrays are never destroyed");
+        T *array = (T *)Alloc(n * sizeof(T), alignof(T));
+        for (size_t i = 0; i < n; ++i) new (&array[i]) T();
+        return array;
+    }
+
+    size_t BytesUsed() const { return bytesUsed; }
+    size_t BytesReserved() const;
+    size_t HugePageChunks() const;
+
+private:
+    struct Chunk {
+        uint8_t *ptr;
+        size_t size;
+        bool mapped;  // from mmap, huge page backed
+    };
+    struct Destructor {
+        void (*destroy)(void *);
+        void *object;
+    };
+
+    void NextChunk(size_t minBytes);
+
+    const size_t chunkSize;
+    uint8_t *currentChunk = nullptr;
+    size_t currentPos = 0, currentSize = 0, bytesUsed = 0;
+    std::vector<Chunk> chunks;
+    std::vector<Destructor> destructors;
+};
+
+// std allocator over a SceneArena, deallocation is then a no-op; without an
+// arena it falls back to the regular heap
+template <typename T>
+struct SceneAllocator {
+    typedef T value_type;
+
+    SceneAllocator(SceneArena *arena = nullptr) : arena(arena) {}
+    template <typename U>
+    SceneAllocator(const SceneAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n) {
+        if (!arena) return std::allocator<T>().allocate(n);
+        return (T *)arena->Alloc(n * sizeof(T), alignof(T));
+    }
+    void deallocate(T *p, size_t n) {
+        if (!arena) std::allocator<T>().deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const SceneAllocator<U> &other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const SceneAllocator<U> &other) const { return arena != other.arena; }
+
+    SceneArena *arena;
+};
+
+// vector that lives in the scene's arena; size it up front, growth leaves the old
+// storage behind in the arena
+template <typename T>
+using SceneVector = std::vector<T, SceneAllocator<T>>;
+
+#endif
@@ -1,4 +1,5 @@
 #include "microfacet.h"
+#include "bsdf.h"
 
 static void TrowbridgeReitzSample11(float cosTheta, float U1, float U2, float *slope_x, float *slope_y) {
     // special case (normal incidence)
@@ -2,7 +2,6 @@
 #define MICROFACET_H
 
 #include "vector.h"
-#include "bsdf.h"
 
 class MicrofacetDistribution {
 public:
@@ -24,7 +23,7 @@ protected:
     const bool sampleVisibleArea;
 };
 
-class TrowbridgeReitzDistribution : public MicrofacetDistribution {
+class TrowbridgeReitzDistribution final : public MicrofacetDistribution {
 public:
     static inline float RoughnessToAlpha(float roughness);
     TrowbridgeReitzDistribution(float alphax, float alphay, bool samplevis = true)
@@ -0,0 +1,203 @@
+#include "net.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define HAVE_SOCKETS
+#endif
+
+Socket &Socket::operator=(Socket &&other) {
+    if (this != &other) {
+        Close();
+        fd = other.fd;
+        other.fd = -1;
+    }
+    return *this;
+}
+
+#ifdef HAVE_SOCKETS
+
+Socket Socket::Listen(int port, bool loopbackOnly) {
+    Socket s(socket(AF_INET, SOCK_STREAM, 0));
+    if (!s.Valid()) {
+        std::cerr << "ERROR: Could not create a socket.\n";
+        return s;
+    }
+    int yes = 1;
+    setsockopt(s.fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+    addr.sin_port = htons((uint16_t)port);
+    if (bind(s.fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(s.fd, 64) != 0) {
+        std::cerr << "ERROR: Could not listen on port " << port << ".\n";
+        s.Close();
+    }
+    return s;
+}
+
+Socket Socket::Connect(const std::string &host, int port) {
+    addrinfo hints = {}, *result = nullptr;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    Socket s;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) == 0) {
+        for (addrinfo *ai = result; ai && !s.Valid(); ai = ai->ai_next) {
+            s = Socket(socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol));
+            if (s.Valid() && connect(s.fd, ai->ai_addr, ai->ai_addrlen) != 0) s.Close();
+        }
+        freeaddrinfo(result);
+    }
+    if (!s.Valid()) {
+        std::cerr << "ERROR: Could not connect to " << host << ":" << port << ".\n";
+        return s;
+    }
+    // replies are small and latency bound
+    int yes = 1;
+    setsockopt(s.fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    return s;
+}
+
+Socket Socket::ListenUnix(const std::string &path) {
+    sockaddr_un addr = {};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "ERROR: Socket path '" << path << "' is too long.\n";
+        return Socket();
+    }
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    Socket s(socket(AF_UNIX, SOCK_STREAM, 0));
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path.c_str());
+    if (!s.Valid() || bind(s.fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(s.fd, 16) != 0) {
+        std::cerr << "ERROR: Could not listen on '" << path << "'.\n";
+        s.Close();
+    }
+    return s;
+}
+
+Socket Socket::Accept() const {
+    Socket s(accept(fd, nullptr, nullptr));
+    if (!s.Valid()) {
+        std::cerr << "ERROR: Could not accept a connection.\n";
+        return s;
+    }
+    // fails harmlessly on Unix domain sockets
+    int yes = 1;
+    setsockopt(s.fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    return s;
+}
+
+int Socket::Port() const {
+    sockaddr_in addr = {};
+    socklen_t len = sizeof(addr);
+    if (getsockname(fd, (sockaddr *)&addr, &len) != 0) return -1;
+    return ntohs(addr.sin_port);
+}
+
+bool Socket::WaitReadable(double seconds) const {
+    pollfd p = {fd, POLLIN, 0};
+    return poll(&p, 1, (int)(seconds * 1000)) > 0;
+}
+
+void Socket::Close() {
+    if (fd >= 0) close(fd);
+    fd = -1;
+}
+
+bool Socket::Send(const void *data, size_t size) const {
+    const uint8_t *p = (const uint8_t *)data;
+    while (size > 0) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool Socket::Recv(void *data, size_t size) const {
+    uint8_t *p = (uint8_t *)data;
+    while (size > 0) {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n <= 0) return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+#else
+
+Socket Socket::Listen(int port, bool loopbackOnly) {
+    std::cerr << "ERROR: Sockets are not supported on this platform.\n";
+    return Socket();
+}
+
+Socket Socket::Connect(const std::string &host, int port) {
+    std::cerr << "ERROR: Sockets are not supported on this platform.\n";
+    return Socket();
+}
+
+Socket Socket::ListenUnix(const std::string &path) {
+    std::cerr << "ERROR: Sockets are not supported on this platform.\n";
+    return Socket();
+}
+
+Socket Socket::Accept() const { return Socket(); }
+int Socket::Port() const { return -1; }
+bool Socket::WaitReadable(double seconds) const { return false; }
+void Socket::Close() { fd = -1; }
+bool Socket::Send(const void *data, size_t size) const { return false; }
+bool Socket::Recv(void *data, size_t size) const { return false; }
+
+#endif
+
+bool Socket::SendMessage(uint32_t type, const void *payload, size_t size) const {
+    // header in one piece, with TCP_NODELAY every send is a segment
+    uint8_t header[12];
+    uint64_t size64 = size;
+    memcpy(header, &type, 4);
+    memcpy(header + 4, &size64, 8);
+    return Send(header, sizeof(header)) && Send(payload, size);
+}
+
+bool Socket::RecvMessage(uint32_t *type, std::vector<uint8_t> *payload, uint64_t maxSize) const {
+    uint64_t size;
+    if (!Recv(type, sizeof(*type)) || !Recv(&size, sizeof(size))) return false;
+    if (size > maxSize) {
+        std::cerr << "ERROR: Refusing a " << size << " byte message, at most " << maxSize << " expected.\n";
+        return false;
+    }
+    payload->resize(size);
+    return Recv(payload->data(), size);
+}
+
+bool Socket::SendLine(const std::string &line) const {
+    return Send(line.data(), line.size()) && Send("\n", 1);
+}
+
+bool Socket::RecvLine(std::string *line) const {
+    // a byte at a time, so nothing past the newline is consumed; job lines are short
+    line->clear();
+    char c;
+    while (Recv(&c, 1)) {
+        if (c == '\n') return true;
+        line->push_back(c);
+    }
+    return !line->empty();
+}
+
+bool ParseAddress(const std::string &address, std::string *host, int *port) {
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos || colon + 1 == address.size()) return false;
+    *host = colon > 0 ? address.substr(0, colon) : "127.0.0.1";
+    *port = atoi(address.c_str() + colon + 1);
+    return *port > 0;
+}
@@ -0,0 +1,66 @@
+#ifndef NET_H
+#define NET_H
+
+#include "global.h"
+
+#include <string>
+
+/*
+minimal blocking sockets for distributed rendering (TCP) and the render
+server (Unix domain), POSIX only.
+Messages are framed as a 4-byte type and an 8-byte payload size followed by
+the payload; both ends are assumed to share byte order and struct layout,
+i.e. to run the same build. Failures are reported on std::cerr and leave
+the socket invalid or make the call return false.
+*/
+
+class Socket {
+public:
+    static constexpr uint64_t MaxMessageSize = uint64_t(1) << 30;
+
+    Socket() = default;
+    explicit Socket(int fd) : fd(fd) {}
+    Socket(Socket &&other) : fd(other.fd) { other.fd = -1; }
+    Socket &operator=(Socket &&other);
+    Socket(const Socket &) = delete;
+    Socket &operator=(const Socket &) = delete;
+    ~Socket() { Close(); }
+
+    // Listens on every interface, or only on 127.0.0.1 with loopbackOnly; port 0
+    // picks a free port, see Port()
+    static Socket Listen(int port, bool loopbackOnly = false);
+    static Socket Connect(const std::string &host, int port);
+    // Unix domain socket at path, replacing a stale socket left behind; any
+    // other kind of file at path is left alone and makes this fail
+    static Socket ListenUnix(const std::string &path);
+    Socket Accept() const;
+
+    bool Valid() const { return fd >= 0; }
+    int Port() const;
+    // True once there is data (or a connection to accept) within seconds
+    bool WaitReadable(double seconds) const;
+    void Close();
+
+    bool Send(const void *data, size_t size) const;
+    bool Recv(void *data, size_t size) const;
+
+    bool SendMessage(uint32_t type, const void *payload, size_t size) const;
+    bool SendMessage(uint32_t type, const std::vector<uint8_t> &payload) const {
+        return SendMessage(type, payload.data(), payload.size());
+    }
+    // A payload above maxSize is refused before anything is allocated for it, the
+    // connection is then out of step and should be dropped
+    bool RecvMessage(uint32_t *type, std::vector<uint8_t> *payload, uint64_t maxSize = MaxMessageSize) const;
+
+    // newline terminated text, for the render server; the newline is not part of line
+    bool SendLine(const std::string &line) const;
+    bool RecvLine(std::string *line) const;
+
+private:
+    int fd = -1;
+};
+
+// "host:port" -> host, port; false if there is no port
+bool ParseAddress(const std::string &address, std::string *host, int *port);
+
+#endif
@@ -0,0 +1,80 @@
+#include "numa.h"
+
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+// "0-3,8-11" -> 0 1 2 3 8 9 10 11
+static std::vector<int> ParseCpuList(const std::string &list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty()) continue;
+        size_t dash = range.find('-');
+        int first = atoi(range.c_str());
+        int last = dash == std::string::npos ? first : atoi(range.c_str() + dash + 1);
+        for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+NumaTopology::NumaTopology() {
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool haveMask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+    for (int node = 0; ; ++node) {
+        std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!in) break;
+        std::string list;
+        std::getline(in, list);
+        std::vector<int> cpus;
+        for (int cpu : ParseCpuList(list))
+            if (!haveMask || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) cpus.push_back(cpu);
+        if (!cpus.empty()) nodeCpus.push_back(cpus);
+    }
+#endif
+    if (nodeCpus.empty()) {
+        nodeCpus.emplace_back();
+        for (int cpu = 0; cpu < omp_get_num_procs(); ++cpu) nodeCpus[0].push_back(cpu);
+    }
+}
+
+std::vector<int> NumaTopology::AllCpus() const {
+    std::vector<int> all;
+    for (const auto &cpus : nodeCpus) all.insert(all.end(), cpus.begin(), cpus.end());
+    return all;
+}
+
+int NumaTopology::CpuForThread(int thread) const {
+    int nCpus = 0;
+    for (const auto &cpus : nodeCpus) nCpus += (int)cpus.size();
+    thread %= nCpus;
+    for (const auto &cpus : nodeCpus) {
+        if (thread < (int)cpus.size()) return cpus[thread];
+        thread -= (int)cpus.size();
+    }
+    return 0;
+}
+
+int NumaTopology::NodeOfCpu(int cpu) const {
+    for (int node = 0; node < NodeCount(); ++node)
+        for (int c : nodeCpus[node])
+            if (c == cpu) return node;
+    return 0;
+}
+
+bool PinThread(const std::vector<int> &cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
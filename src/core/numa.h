@@ -0,0 +1,34 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include "global.h"
+
+/*
+NUMA topology and thread pinning without libnuma: nodes and their CPUs come
+from /sys/devices/system/node, pinning uses sched_setaffinity. Memory is
+placed by first touch, so anything a pinned thread allocates and fills
+itself ends up on its own node. Only CPUs in the process' affinity mask at
+construction are listed, so taskset and cgroup limits are kept. Elsewhere everything reports a single node
+and pinning is a no-op.
+*/
+
+class NumaTopology {
+public:
+    NumaTopology();
+
+    int NodeCount() const { return (int)nodeCpus.size(); }
+    const std::vector<int> &NodeCpus(int node) const { return nodeCpus[node]; }
+    std::vector<int> AllCpus() const;
+
+    // CPU for render thread i, filling the first node's CPUs before the next
+    int CpuForThread(int thread) const;
+    int NodeOfCpu(int cpu) const;
+
+private:
+    std::vector<std::vector<int>> nodeCpus;
+};
+
+// Restricts the calling thread to cpus; false if that is not supported
+bool PinThread(const std::vector<int> &cpus);
+
+#endif
@@ -6,10 +6,26 @@
 #include "../accelerators/aabb.h"
 #include "record.h"
 
+// What traversal produces: just enough to pick the closest hit and to rebuild
+// the full HitRecord for it afterwards, see Object::ComputeSurfaceInteraction()
+struct RawHit
+{
+    float t;
+    float u, v;            // barycentrics of v1 and v2 on triangles, surface parameters otherwise
+    uint32_t primID = 0;   // element inside the primitive (particle, micro-triangle)
+    const Object *primitive = nullptr;
+};
+static_assert(sizeof(RawHit) <= 32, "RawHit should fit half a cache line");
+
+// Concrete type of a primitive, so aggregates can group primitives by type and
+// call them directly instead of through the virtual interface
+enum class ShapeType { Other, Triangle, Sphere, XYRect, XZRect, YZRect };
+
 class Object
 {
 public:
-    Object(std::shared_ptr<MediumRecord> mediumRecord = nullptr) : mediumRecord(mediumRecord) {}
+    Object(const MediumRecord *mediumRecord = nullptr, ShapeType shapeType = ShapeType::Other)
+        : mediumRecord(mediumRecord), shapeType(shapeType) {}
     virtual bool hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const = 0;
     virtual bool bounding_box(double time0, double time1, AABB &output_box) const = 0;
     virtual double pdf_value(const Point3f &o, const Vector3f &v) const
@@ -17,16 +33,55 @@ public:
         return 0.0;
     }
 
-    virtual Vector3f random(const Vector3f &o) const
+    // Direction from o to a point on the surface, placed by the uniform sample u
+    virtual Vector3f random(const Vector3f &o, const Point2f &u) const
     {
         return Vector3f(1, 0, 0);
     }
 
-    virtual bool Intersect(const Ray &ray, HitRecord &isect) const = 0;
+    // Closest hit before ray.tMax; on a hit shortens ray.tMax and fills hit only
+    virtual bool IntersectHit(const Ray &ray, RawHit &hit) const = 0;
+
+    // Rebuilds the full hit record from a RawHit this primitive reported for ray
+    virtual void ComputeSurfaceInteraction(const Ray &ray, const RawHit &hit, HitRecord &isect) const {}
+
+    // Texture coordinates of a RawHit without rebuilding the rest of the surface,
+    // the same uv ComputeShadingGeometry() would report
+    virtual Point2f HitUV(const RawHit &hit) const
+    {
+        return Point2f(hit.u, hit.v);
+    }
+
+    // IntersectHit() followed by reconstruction of the closest hit
+    bool Intersect(const Ray &ray, HitRecord &isect) const;
+
+    virtual void ComputeShadingGeometry(HitRecord &isect) const
+    {
+        isect.shadingNormal = isect.normal;
+        isect.uv = Point2f(isect.u, isect.v);
+    }
 
 public:
     float area = 0;
-    std::shared_ptr<MediumRecord> mediumRecord;
+    const MediumRecord *mediumRecord;   // not owned, lives in the scene's arena
+    ShapeType shapeType;
 };
 
+inline bool Object::Intersect(const Ray &ray, HitRecord &isect) const
+{
+    RawHit hit;
+    if (!IntersectHit(ray, hit)) return false;
+    hit.primitive->ComputeSurfaceInteraction(ray, hit, isect);
+    return true;
+}
+
+inline void HitRecord::ComputeShadingGeometry()
+{
+    if (object) object->ComputeShadingGeometry(*this);
+    else {
+        shadingNormal = normal;
+        uv = Point2f(u, v);
+    }
+}
+
 #endif
\ No newline at end of file
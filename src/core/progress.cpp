@@ -0,0 +1,66 @@
+#include "progress.h"
+
+#include <cstdio>
+
+ProgressReporter::ProgressReporter(int nTiles, int nThreads, double interval)
+    : nTiles(nTiles), nThreads(nThreads), interval(interval), counters(new Counters[nThreads]),
+      start(std::chrono::steady_clock::now()) {
+    reporter = std::thread(&ProgressReporter::Run, this);
+}
+
+void ProgressReporter::Done() {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (done) return;
+        done = true;
+    }
+    wakeUp.notify_one();
+    reporter.join();
+    Print(true);
+}
+
+void ProgressReporter::Run() {
+    std::unique_lock<std::mutex> guard(mutex);
+    auto period = std::chrono::duration<double>(interval);
+    while (!wakeUp.wait_for(guard, period, [this]() { return done; }))
+        Print(false);
+}
+
+// 1234567 -> "1.23 M"
+static std::string Rate(double perSecond) {
+    const char *units[] = {"", "k", "M", "G"};
+    int unit = 0;
+    while (perSecond >= 1000 && unit < 3) {
+        perSecond /= 1000;
+        ++unit;
+    }
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.2f %s", perSecond, units[unit]);
+    return buf;
+}
+
+void ProgressReporter::Print(bool final) const {
+    uint64_t tiles = 0, samples = 0, rays = 0;
+    for (int t = 0; t < nThreads; ++t) {
+        tiles += counters[t].tiles.load(std::memory_order_relaxed);
+        samples += counters[t].samples.load(std::memory_order_relaxed);
+        rays += counters[t].rays.load(std::memory_order_relaxed);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    float progress = nTiles > 0 ? (float)tiles / nTiles : 1.f;
+
+    int barWidth = 40, pos = barWidth * progress;
+    std::string bar(barWidth, ' ');
+    for (int i = 0; i < barWidth; ++i) bar[i] = i < pos ? '=' : i == pos ? '>' : ' ';
+
+    std::cout << "[" << bar << "] " << int(progress * 100.f) << " % " << tiles << "/" << nTiles << " tiles, "
+              << Rate(samples / std::max(seconds, 1e-3)) << "samples/s";
+    if (rays > 0) std::cout << ", " << Rate(rays / std::max(seconds, 1e-3)) << "rays/s";
+    if (final)
+        std::cout << ", " << (int)seconds << " s    \n";
+    else {
+        if (tiles > 0) std::cout << ", ETA " << (int)(seconds * (nTiles - tiles) / tiles) << " s";
+        std::cout << "    \r";
+    }
+    std::cout.flush();
+}
@@ -0,0 +1,56 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include "global.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/*
+progress reporting for the render loop. Every render thread bumps relaxed
+atomic counters in its own cache line after each tile, which never blocks;
+a separate reporter thread sums them a few times a second and prints tiles
+done, samples/s, rays/s and the time left.
+*/
+
+class ProgressReporter {
+public:
+    ProgressReporter(int nTiles, int nThreads, double interval = 0.5);
+    ProgressReporter(const ProgressReporter &) = delete;
+    ProgressReporter &operator=(const ProgressReporter &) = delete;
+    ~ProgressReporter() { Done(); }
+
+    // Called by render thread `thread` once it finished a tile
+    void TileDone(int thread, uint64_t samples, uint64_t rays) {
+        Counters &c = counters[thread];
+        c.tiles.fetch_add(1, std::memory_order_relaxed);
+        c.samples.fetch_add(samples, std::memory_order_relaxed);
+        c.rays.fetch_add(rays, std::memory_order_relaxed);
+    }
+
+    // Stops the reporter and prints the final line; called by the destructor
+    void Done();
+
+private:
+    struct alignas(64) Counters {
+        std::atomic<uint64_t> tiles{0}, samples{0}, rays{0};
+    };
+
+    void Run();
+    void Print(bool final) const;
+
+    const int nTiles, nThreads;
+    const double interval;
+    std::unique_ptr<Counters[]> counters;
+    const std::chrono::steady_clock::time_point start;
+
+    // only shared between the caller and the reporter thread
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool done = false;
+    std::thread reporter;
+};
+
+#endif
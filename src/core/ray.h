@@ -7,7 +7,7 @@ class Ray
 {
 public:
     Ray() : tMax(INF), time(0.f), medium(nullptr) {}
-    Ray(const Point3f &o, const Vector3f &d, float tMax = INF, float time = 0.f, std::shared_ptr<Medium> medium = nullptr)
+    Ray(const Point3f &o, const Vector3f &d, float tMax = INF, float time = 0.f, const Medium *medium = nullptr)
         : o(o), d(d), tMax(tMax), time(time), medium(medium) {}
     Point3f operator()(float t) const { return o + d * t; }
     friend std::ostream& operator<<(std::ostream& os, const Ray &r) {
@@ -19,7 +19,9 @@ public:
     Vector3f d;
     mutable float tMax;
     float time;
-    std::shared_ptr<Medium> medium;
+    const Medium *medium;   // not owned, media live as long as the scene
+    // Set on queries that only care about opaque geometry, see PassThroughFilter()
+    bool skipPassThrough = false;
 };
 
 class RayDifferential : public Ray {
@@ -27,7 +29,7 @@ public:
     RayDifferential() { hasDifferentials = false; }
     RayDifferential(const Vector3f &o, const Vector3f &d,
                     float tMax = Infinity, float time = 0.f,
-                    std::shared_ptr<Medium> medium = nullptr)
+                    const Medium *medium = nullptr)
                 : Ray(o, d, tMax, time, medium) {
                     hasDifferentials = false;
     }
@@ -7,40 +7,61 @@
 
 struct MediumRecord {
     MediumRecord() { inside = outside = nullptr; }
-    std::shared_ptr<Medium> inside, outside;
-    MediumRecord(std::shared_ptr<Medium> medium) : inside(medium), outside(medium) {}
-    MediumRecord(std::shared_ptr<Medium> inside, std::shared_ptr<Medium> outside) : inside(inside), outside(outside) {}
+    // Non-owning: copied into every hit record, so no reference counting on the hot path
+    const Medium *inside, *outside;
+    MediumRecord(const Medium *medium) : inside(medium), outside(medium) {}
+    MediumRecord(const Medium *inside, const Medium *outside) : inside(inside), outside(outside) {}
     bool IsMediumTransition() const { return inside != outside; }
     bool IsValid() const { return phase != nullptr; }
-    std::shared_ptr<PhaseFunction> phase;
+    const PhaseFunction *phase = nullptr;
 };
 
 struct HitRecord
 {
     HitRecord() {}
     Point3f p;
+    Vector3f pError;   // conservative absolute error of p, see OffsetRayOrigin()
     Vector3f normal;
     Vector3f wo, wi;
-    std::shared_ptr<Material> mat_ptr;
-    std::shared_ptr<BSDF> bsdf;
-    double t;
-    double u, v;
+    const Material *mat_ptr = nullptr;   // lives in the scene's arena
+    BSDF *bsdf = nullptr;   // allocated from the per-thread MemoryArena
+    float t;
+    float u, v;
     Spectrum Le = 0.f;
     bool front_face;
     MediumRecord mediumRecord;
 
-    std::shared_ptr<Material> GetMaterial() { return mat_ptr; }
-    const std::shared_ptr<Medium> GetMedium(const Vector3f &d) {
+    // Filled by the intersected shape on demand, see ComputeShadingGeometry()
+    const Object *object = nullptr;
+    Vector3f shadingNormal;
+    Point2f uv;
+
+    const Material *GetMaterial() const { return mat_ptr; }
+    const Medium *GetMedium(const Vector3f &d) const {
         if (mediumRecord.outside == nullptr && mediumRecord.inside == nullptr) return nullptr;
         return (Dot(normal, d) > 0) ? mediumRecord.outside : mediumRecord.inside;
     }
 
+    Ray SpawnRay(const Vector3f &d, const Medium *medium = nullptr) const {
+        Point3f o = OffsetRayOrigin(p, pError, normal, d);
+        return Ray(o, d, Infinity, 0.f, medium);
+    }
+
+    // d is unnormalized so that t = 1 lands on p2, the ray stops just short of it
+    Ray SpawnRayTo(const Point3f &p2, const Medium *medium = nullptr) const {
+        Point3f o = OffsetRayOrigin(p, pError, normal, p2 - p);
+        return Ray(o, p2 - o, 1 - ShadowEpsilon, 0.f, medium);
+    }
+
     inline void set_face_normal(const Ray &r, const Vector3f &outward_normal)
     {
         front_face = Dot(r.d, outward_normal) < 0;
         normal = front_face ? outward_normal : -outward_normal;
     }
 
+    // Decodes shading normal and UVs; only called for hits that are actually shaded
+    inline void ComputeShadingGeometry();
+
     bool IsSurface() const {
         return normal != Vector3f(0.f);
     }
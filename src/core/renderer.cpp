@@ -2,6 +2,12 @@
 
 #include "object.h"
 #include "hittable_list.h"
+#include "filter.h"
+#include "allocstats.h"
+#include "film.h"
+#include "distributed.h"
+#include "numa.h"
+#include "progress.h"
 #include "../accelerators/bvh.h"
 #include "../core/light.h"
 #include "../core/material.h"
@@ -10,6 +16,8 @@
 #include "../shapes/triangle.h"
 #include "../shapes/aarect.h"
 #include "../shapes/sphere.h"
+#include "../shapes/displaced.h"
+#include "../shapes/particles.h"
 #include "../materials/matte.h"
 #include "../materials/glass.h"
 #include "../materials/metal.h"
@@ -17,121 +25,383 @@
 #include "../integrators/path.h"
 #include "../integrators/volpath.h"
 #include "../medium/homogeneous.h"
+#include "../samplers/independent.h"
+#include "../samplers/stratified.h"
+#include "../samplers/halton.h"
+#include "../samplers/sobol.h"
+
+#include <atomic>
+#include <fstream>
+#include <shared_mutex>
+#include <thread>
+
+static uint64_t HashString(uint64_t h, const std::string &s) {
+    for (char c : s) h = MixBits(h ^ (uint8_t)c);
+    return MixBits(h ^ s.size());
+}
+
+static uint64_t HashFloats(uint64_t h, std::initializer_list<float> values) {
+    for (float v : values) h = MixBits(h ^ FloatToBits(v));
+    return h;
+}
+
+uint64_t JobKey(const RenderJob &job) {
+    uint64_t h = MixBits(job.seed ^ ((uint64_t)job.spp << 32));
+    h = MixBits(h ^ ((uint64_t)job.width << 32 | (uint32_t)job.height));
+    h = HashString(HashString(HashString(h, job.model), job.integrator), job.sampler);
+    h = HashFloats(h, {job.modelScale, job.lookfrom.x, job.lookfrom.y, job.lookfrom.z, job.lookat.x, job.lookat.y,
+                       job.lookat.z, job.vup.x, job.vup.y, job.vup.z, job.vfov, job.aperture, job.focusDistance});
+    // adaptive settings only matter while adaptive sampling is on
+    if (job.adaptive.enabled)
+        h = HashFloats(MixBits(h ^ (uint64_t)job.adaptive.minSpp), {(float)job.adaptive.maxRelativeError});
+    return h;
+}
+
+bool IsSamplerName(const std::string &name) {
+    return name == "sobol" || name == "halton" || name == "stratified" || name == "independent";
+}
+
+bool CheckSamplerSpp(const RenderJob &job, std::string *error) {
+    // the Sobol sampler would round anything else up, rendering more than asked
+    if (job.sampler == "sobol" && !IsPowerOf2(job.spp)) {
+        *error = "spp must be a power of two for the sobol sampler, got " + std::to_string(job.spp);
+        return false;
+    }
+    return true;
+}
+
+static std::shared_ptr<Sampler> MakeSampler(const std::string &name, int spp, uint64_t seed) {
+    if (name == "halton") return std::make_shared<HaltonSampler>(spp, seed);
+    if (name == "independent") return std::make_shared<IndependentSampler>(spp, seed);
+    if (name == "stratified") {
+        // the squarest x * y grid with exactly spp strata
+        int x = (int)std::sqrt((double)spp);
+        while (spp % x != 0) --x;
+        return std::make_shared<StratifiedSampler>(spp / x, x, true, seed);
+    }
+    return std::make_shared<SobolSampler>(spp, seed);
+}
+
+size_t LoadedScene::Bytes() const {
+    size_t bytes = arena.BytesReserved() + (scene ? scene->Bytes() : 0);
+    for (const auto &replicaArena : replicaArenas) bytes += replicaArena->BytesReserved();
+    for (const auto &replica : replicas)
+        if (replica) bytes += replica->Bytes();
+    return bytes;
+}
 
 void Renderer::Render() {
+    RenderJob job;
+    job.outputFile = options.outputFile;
+    job.seed = options.seed;
+    if (options.spp > 0) job.spp = options.spp;
+    job.adaptive = options.adaptive;
+    if (!options.sampler.empty()) job.sampler = options.sampler;
+    Render(job);
+}
+
+std::shared_ptr<const LoadedScene> Renderer::LoadScene(const RenderJob &job) {
+    // TriangleMesh exits on a model it cannot read, a server has to refuse the job instead
+    if (!std::ifstream(job.model)) {
+        std::cerr << "ERROR: Could not open model '" << job.model << "'.\n";
+        return nullptr;
+    }
+    std::string key = job.model + "@" + std::to_string(job.modelScale);
+    return sceneCache.Lookup(key, [&]() { return BuildScene(job); });
+}
 
-    std::vector<std::shared_ptr<Object>> objects; std::vector<std::shared_ptr<Light>> lights;
+std::shared_ptr<LoadedScene> Renderer::BuildScene(const RenderJob &job) {
+    auto loaded = std::make_shared<LoadedScene>();
+    // construction randomness (textures, particles) must not depend on earlier builds
+    SeedRandom(0);
+    SceneArena &sceneArena = loaded->arena;
+    auto loadStart = std::chrono::steady_clock::now();
 
-    auto white = std::make_shared<Matte>(Spectrum(.73f, .73f, .73f), 1.f);
-    auto red = std::make_shared<Matte>(Spectrum(.75, .25, .25), 1.f);
-    auto blue = std::make_shared<Matte>(Spectrum(.25, .25, .75), 1.f);
-    auto green = std::make_shared<Matte>(Spectrum(.12, .45, .15), 1.f);
-    auto black = std::make_shared<Matte>(Spectrum(.01, .01, .01), 1.f);
-    auto grey = std::make_shared<Matte>(Spectrum(.61, .61, .61), 1.f);
+    std::vector<const Object *> objects; std::vector<const Light *> lights;
+
+    auto white = sceneArena.New<Matte>(Spectrum(.73f, .73f, .73f), 1.f);
+    auto red = sceneArena.New<Matte>(Spectrum(.75, .25, .25), 1.f);
+    auto blue = sceneArena.New<Matte>(Spectrum(.25, .25, .75), 1.f);
+    auto green = sceneArena.New<Matte>(Spectrum(.12, .45, .15), 1.f);
+    auto black = sceneArena.New<Matte>(Spectrum(.01, .01, .01), 1.f);
+    auto grey = sceneArena.New<Matte>(Spectrum(.61, .61, .61), 1.f);
     
-    auto metal_silver = std::make_shared<Metal>(Spectrum(0.041000, 0.059582, 0.040000), Spectrum(4.8025, 3.5974, 2.6484), 0.1);
-    auto metal_gold = std::make_shared<Metal>(Spectrum(0.13100, 0.42415, 1.3831), Spectrum(4.0624, 2.4721, 1.9155), 0.1);
+    auto metal_silver = sceneArena.New<Metal>(Spectrum(0.041000, 0.059582, 0.040000), Spectrum(4.8025, 3.5974, 2.6484), 0.1);
+    auto metal_gold = sceneArena.New<Metal>(Spectrum(0.13100, 0.42415, 1.3831), Spectrum(4.0624, 2.4721, 1.9155), 0.1);
     
-    auto plastic = std::make_shared<Plastic>(Spectrum(0.294, 0.f, 0.509), Spectrum(1.f, 1.f, 1.f), 0.01);
+    auto plastic = sceneArena.New<Plastic>(Spectrum(0.294, 0.f, 0.509), Spectrum(1.f, 1.f, 1.f), 0.01);
     
     Spectrum lightColor = 8.0f * Spectrum(0.747f+0.058f, 0.747f+0.258f, 0.747f) + 15.6f * Spectrum(0.740f+0.287f,0.740f+0.160f,0.740f) + 18.4f * Spectrum(0.737f+0.642f,0.737f+0.159f,0.737f);
     
-    auto roughGlass = std::make_shared<Glass>(Spectrum(1.f), Spectrum(1.f), 0.1f, 1.5f);
-    auto jadeGlass = std::make_shared<Glass>(Spectrum(1.f), Spectrum(1.f), 0.0f, 1.6f);
+    auto roughGlass = sceneArena.New<Glass>(Spectrum(1.f), Spectrum(1.f), 0.1f, 1.5f);
+    auto jadeGlass = sceneArena.New<Glass>(Spectrum(1.f), Spectrum(1.f), 0.0f, 1.6f);
     
-    auto thin_media = std::make_shared<HomogeneousMedium>(0.001, 0.0012, 0.0);
-    auto jade_media = std::make_shared<HomogeneousMedium>(Spectrum(0.00053, 0.00123, 0.00213), Spectrum(0.00657, 0.00186, 0.009), 0.f);
+    auto thin_media = sceneArena.New<HomogeneousMedium>(0.001, 0.0012, 0.0);
+    auto jade_media = sceneArena.New<HomogeneousMedium>(Spectrum(0.00053, 0.00123, 0.00213), Spectrum(0.00657, 0.00186, 0.009), 0.f);
 
-    auto jade_medium = std::make_shared<MediumRecord>(jade_media, nullptr);
+    auto jade_medium = sceneArena.New<MediumRecord>(jade_media, nullptr);
 
-    auto light = make_shared<XZRect>(213, 343, 227, 332, 554, nullptr);
-    auto diffuseLight = make_shared<DiffuseAreaLight>(lightColor, 1, light, false);
+    auto light = sceneArena.New<XZRect>(213, 343, 227, 332, 554, nullptr);
+    auto diffuseLight = sceneArena.New<DiffuseAreaLight>(lightColor, 1, light, false);
     
-    std::string model = "../models/bunny/bunny.obj";
-    std::string mtl_path = "../models/bunny/";
-    TriangleMesh bunny = TriangleMesh(0.f, Vector3f(278, 0, 278), 2000.f, model, mtl_path, roughGlass);
+    std::string model = job.model;
+    std::string mtl_path = model.substr(0, model.find_last_of('/') + 1);
+    TriangleMesh bunny = TriangleMesh(0.f, Vector3f(278, 0, 278), job.modelScale, model, mtl_path, roughGlass, sceneArena);
     ObjectList list;
     for (int s = 0; s < bunny.Triangles.size(); s++) {
-        list.add(make_shared<Triangle>(bunny.Triangles[s]));
+        list.add(bunny.Triangles[s]);
     }
     
     //ObjectList list;
-    list.add(std::make_shared<YZRect>(0, 555, 0, 555, 555, red));
-    list.add(std::make_shared<YZRect>(0, 555, 0, 555, 0, blue));
-    list.add(std::make_shared<XZRect>(0, 555, 0, 555, 0, white));
-    list.add(std::make_shared<XZRect>(0, 555, 0, 555, 555, white));
-    list.add(std::make_shared<XYRect>(0, 555, 0, 555, 555, white));
-    list.add(std::make_shared<XZRect>(213, 343, 227, 332, 554, nullptr));
-    //list.add(std::make_shared<Sphere>(Point3f(138.75, 150, 138.75), 100, plastic, no_medium));
-    //list.add(std::make_shared<Sphere>(Point3f(416.25, 150, 138.75), 100, roughGlass, medium));
-    //list.add(std::make_shared<Sphere>(Point3f(138.75, 350, 416.25), 100, metal_gold, no_medium));
-    //list.add(std::make_shared<Sphere>(Point3f(416.25, 350, 416.25), 100, white, no_medium));
-    //list.add(std::make_shared<Sphere>(Point3f(277, 210, 277), 100, jadeGlass, jade_medium));
+    list.add(sceneArena.New<YZRect>(0, 555, 0, 555, 555, red));
+    list.add(sceneArena.New<YZRect>(0, 555, 0, 555, 0, blue));
+    list.add(sceneArena.New<XZRect>(0, 555, 0, 555, 0, white));
+    list.add(sceneArena.New<XZRect>(0, 555, 0, 555, 555, white));
+    list.add(sceneArena.New<XYRect>(0, 555, 0, 555, 555, white));
+    auto lightQuad = sceneArena.New<XZRect>(213, 343, 227, 332, 554, nullptr);
+    list.add(sceneArena.New<FilteredObject>(lightQuad, PassThroughFilter));
+
+    // Cut-out screen in front of the back wall: an 8x8 checker alpha mask punches holes into the quad
+    //std::vector<float> checker(64);
+    //for (int i = 0; i < 64; i++) checker[i] = ((i / 8 + i % 8) & 1) ? 1.f : 0.f;
+    //auto screen = sceneArena.New<XYRect>(150, 405, 150, 405, 500, green);
+    //list.add(sceneArena.New<FilteredObject>(screen, AlphaMaskFilter(std::make_shared<AlphaMask>(8, 8, checker))));
+
+    //list.add(sceneArena.New<Sphere>(Point3f(138.75, 150, 138.75), 100, plastic, no_medium));
+    //list.add(sceneArena.New<Sphere>(Point3f(416.25, 150, 138.75), 100, roughGlass, medium));
+    //list.add(sceneArena.New<Sphere>(Point3f(138.75, 350, 416.25), 100, metal_gold, no_medium));
+    //list.add(sceneArena.New<Sphere>(Point3f(416.25, 350, 416.25), 100, white, no_medium));
+    //list.add(sceneArena.New<Sphere>(Point3f(277, 210, 277), 100, jadeGlass, jade_medium));
+
+    // Displaced terrain, tessellated lazily into a 64 MB geometry cache
+    //auto tessCache = std::make_shared<TessellationCache>(64 << 20);
+    //auto hmap = std::make_shared<DisplacementMap>("../models/spot/hmap.jpg");
+    //list.add(sceneArena.New<DisplacedSurface>(Point3f(0, 1, 0), Point3f(555, 1, 0), Point3f(0, 1, 555), Point3f(555, 1, 555),
+    //                                          hmap, 40.f, 16, 64, 0.5f, grey, tessCache));
+
+    // Dust: one primitive for all particles instead of one Sphere each
+    //std::vector<Point3f> dustCenters; std::vector<float> dustRadii;
+    //for (int s = 0; s < 1000000; s++) {
+    //    dustCenters.push_back(Point3f(random_double(0, 555), random_double(0, 555), random_double(0, 555)));
+    //    dustRadii.push_back(random_double(0.1, 0.3));
+    //}
+    //list.add(sceneArena.New<ParticleCloud>(dustCenters, dustRadii, white));
 
     // objects.push_back(std::make_shared<BVH>(list, 0, 1));
-    objects.push_back(std::make_shared<BVH>(list, 0, 1));
+    objects.push_back(sceneArena.New<BVH>(list, 0, 1, sceneArena));
     lights.push_back(diffuseLight);
 
-    Scene scene(objects, lights);
+    loaded->scene.reset(new Scene(objects, lights, {thin_media, jade_media}));
 
-    Point3f lookfrom(278, 278, -800);
-    Point3f lookat(278, 278, 0);
-    auto vfov = 40.0;
-    Vector3f vup(0, 1, 0);
-    auto dist_to_focus = 10.f;
-    auto aperture = 0.0;
-    int spp = 128;
+    std::chrono::duration<double> loadTime = std::chrono::steady_clock::now() - loadStart;
+    std::cout << "Scene " << model << " built in " << loadTime.count() << " s, " << (sceneArena.BytesUsed() >> 10) << " KB in "
+              << (sceneArena.BytesReserved() >> 20) << " MB of arena (" << sceneArena.HugePageChunks()
+              << " huge page chunks)\n";
 
-    camera cam(lookfrom, lookat, vup, vfov, 1.0, aperture, dist_to_focus, 0.f, 0.f);
+    // one BVH per NUMA node, built by a thread pinned to the node so its memory
+    // is first touched there; primitives, materials and lights stay shared
+    auto &replicaArenas = loaded->replicaArenas;
+    auto &replicas = loaded->replicas;
+    if (options.replicateScene && topology.NodeCount() > 1) {
+        replicaArenas.resize(topology.NodeCount());
+        replicas.resize(topology.NodeCount());
+        std::vector<std::thread> builders;
+        for (int node = 0; node < topology.NodeCount(); ++node)
+            builders.emplace_back([&, node]() {
+                PinThread(topology.NodeCpus(node));
+                replicaArenas[node].reset(new SceneArena);
+                auto bvh = replicaArenas[node]->New<BVH>(list, 0, 1, *replicaArenas[node]);
+                replicas[node].reset(new Scene({bvh}, lights, loaded->scene->media));
+            });
+        for (auto &builder : builders) builder.join();
+        std::cout << "BVH replicated on " << topology.NodeCount() << " NUMA nodes\n";
+    }
+    return loaded;
+}
+
+bool Renderer::Render(const RenderJob &job) {
+    std::shared_ptr<const LoadedScene> loaded = LoadScene(job);
+    if (!loaded) return false;
+    const std::vector<std::unique_ptr<Scene>> &replicas = loaded->replicas;
+    bool pinThreads = options.pinThreads || options.replicateScene;
+    int spp = job.spp;
+    bool adaptive = job.adaptive.enabled;
+    double maxRelativeError = job.adaptive.maxRelativeError;
+
+    int image_height = job.height, image_width = job.width;
+    camera cam(job.lookfrom, job.lookat, job.vup, job.vfov, (double)image_width / image_height, job.aperture,
+               job.focusDistance, 0.f, 0.f);
     m_camera = std::make_shared<camera>(cam);
 
-    Sampler sampler;
-    auto path = std::make_shared<PathIntegrator>(50, nullptr, std::make_shared<Sampler>(sampler));
-    auto volpath = std::make_shared<VolPathIntegrator>(50, nullptr, std::make_shared<Sampler>(sampler));
-    integrator = path;
+    sampler = MakeSampler(job.sampler, spp, job.seed);
+    spp = sampler->SamplesPerPixel();
+    int minSpp = std::min(job.adaptive.minSpp, spp);
+    auto path = std::make_shared<PathIntegrator>(50, nullptr, sampler);
+    auto volpath = std::make_shared<VolPathIntegrator>(50, nullptr, sampler);
+    integrator = job.integrator == "volpath" ? std::static_pointer_cast<Integrator>(volpath) : path;
 
-    int image_height = 600, image_width = 600;
+    Film film(image_width, image_height);
+    RenderLoopStats loopStats;
 
-    std::vector<Vector3f> framebuffer(image_height * image_width);
-    int m = 0;
-    
-    omp_init_lock(&lock);
-    omp_set_num_threads(16);
-#pragma omp parallel for
-    for (int j = image_height - 1; j >= 0; --j) {
-        //std::cerr << "\rScanlines remaining: " << j << ' ' << std::flush;
-        for (int i = 0; i < image_width; ++i) {
-            Spectrum pixel(0.f);
-            for (int s = 0; s < spp; ++s) {
-                auto u = (float)i / ((float)image_width - 1);
-                auto v = (float)j / ((float)image_height - 1);
-                Ray ray = m_camera->get_Ray(u, v);
-                ray.d = Normalize(ray.d);
-                pixel += integrator->Li(ray, scene, sampler);
+    std::string checkpointFile = job.outputFile + ".checkpoint";
+    if (options.resume) {
+        if (!std::ifstream(checkpointFile))
+            std::cout << "No checkpoint " << checkpointFile << ", starting from scratch\n";
+        else if (film.ReadCheckpoint(checkpointFile, spp, job.seed, JobKey(job)))
+            std::cout << "Resuming from " << checkpointFile << " at " << film.SampleCount() << " samples\n";
+    }
+
+    auto renderStart = std::chrono::steady_clock::now();
+    auto elapsed = [&]() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStart).count();
+    };
+    // past the deadline a pass skips its remaining tiles, the film stays valid
+    // as long as the first pass gave every pixel a sample
+    auto outOfTime = [&](int pass) {
+        return pass > 0 && options.timeLimit > 0 && elapsed() >= options.timeLimit;
+    };
+
+    // A checkpoint copies the film while no tile is being stored, render threads
+    // only ever wait for that copy; the file is written outside the lock
+    std::shared_mutex filmMutex;
+    auto writeCheckpoint = [&]() {
+        std::unique_ptr<Film> snapshot;
+        {
+            std::unique_lock<std::shared_mutex> lock(filmMutex);
+            snapshot.reset(new Film(film));
+        }
+        snapshot->WriteCheckpoint(checkpointFile, spp, job.seed, JobKey(job));
+    };
+    // claimed by the first render thread to find it due
+    std::atomic<int64_t> nextCheckpoint((int64_t)(options.checkpointInterval * 1000));
+    auto checkpointDue = [&]() {
+        if (options.checkpointInterval <= 0) return false;
+        int64_t now = (int64_t)(elapsed() * 1000), due = nextCheckpoint.load();
+        return now >= due &&
+               nextCheckpoint.compare_exchange_strong(due, now + (int64_t)(options.checkpointInterval * 1000));
+    };
+
+    int nThreads = RenderThreadCount(options.nThreads);
+    const int tileSize = 16;
+    std::vector<Tile> tiles = HilbertTiles(image_width, image_height, tileSize);
+    if (options.workers == 0) {
+        std::cout << "Rendering " << tiles.size() << " tiles on " << nThreads << " threads";
+        if (pinThreads) std::cout << ", pinned over " << topology.NodeCount() << " NUMA nodes";
+        std::cout << "\n";
+    }
+
+    // Brings every pixel of run that is not converged up to sampleEnd samples
+    auto renderTiles = [&](const std::vector<Tile> &run, int pass, int sampleEnd) {
+        TileScheduler scheduler(run, nThreads);
+        ProgressReporter progress((int)run.size(), nThreads);
+#pragma omp parallel num_threads(nThreads)
+        {
+            int thread = omp_get_thread_num();
+            const Scene *threadScene = loaded->scene.get();
+            if (pinThreads) {
+                int cpu = topology.CpuForThread(thread);
+                PinThread({cpu});
+                if (!replicas.empty()) threadScene = replicas[topology.NodeOfCpu(cpu)].get();
+            }
+            // one shading arena per thread, recycled after every path sample; like
+            // the rest of the per-thread state it is made after pinning, so it is
+            // first touched on the thread's own node
+            MemoryArena arena;
+            // and a private sampler, restarted at every pixel sample
+            std::unique_ptr<Sampler> threadSampler = sampler->Clone();
+            std::vector<FilmPixel> tilePixels;
+            uint64_t allocStart = ThreadAllocations(), rayStart = ThreadRays();
+            Tile tile;
+            while (scheduler.Next(thread, &tile)) {
+                if (outOfTime(pass)) continue;
+                film.CopyTile(tile, &tilePixels);
+                uint64_t tileSamples = 0, tileRays = ThreadRays();
+                for (int j = tile.y0; j < tile.y1; ++j)
+                for (int i = tile.x0; i < tile.x1; ++i) {
+                    FilmPixel &pixel = tilePixels[(size_t)(j - tile.y0) * tile.Width() + (i - tile.x0)];
+                    // a flag from an adaptive checkpoint must not cut a full-spp render short
+                    if (adaptive && pixel.converged) continue;
+                    threadSampler->StartPixel(i, j);
+                    for (int s = pixel.variance.Count(); s < sampleEnd; ) {
+                        threadSampler->StartSample(s);
+                        // the first two dimensions jitter the sample across the pixel
+                        Point2f uFilm = threadSampler->Next2D();
+                        auto u = ((float)i + uFilm.x - 0.5f) / ((float)image_width - 1);
+                        auto v = ((float)j + uFilm.y - 0.5f) / ((float)image_height - 1);
+                        Ray ray = m_camera->get_Ray(u, v, threadSampler->Next2D());
+                        ray.d = Normalize(ray.d);
+                        pixel.AddSample(integrator->Li(ray, *threadScene, *threadSampler, arena));
+                        arena.Reset();
+                        ++s;
+                        ++tileSamples;
+                        // only stop at powers of two, where the low-discrepancy samplers are balanced
+                        if (adaptive && s >= minSpp && (s & (s - 1)) == 0 && pixel.variance.Converged(maxRelativeError)) {
+                            pixel.converged = true;
+                            break;
+                        }
+                    }
+                }
+                {
+                    std::shared_lock<std::shared_mutex> lock(filmMutex);
+                    film.StoreTile(tile, tilePixels);
+                }
+                progress.TileDone(thread, tileSamples, ThreadRays() - tileRays);
+                if (checkpointDue()) writeCheckpoint();
             }
-            auto r = pixel.r;
-            auto g = pixel.g;
-            auto b = pixel.b;
-            // Divide the color by the number of samples and gamma-correct for gamma=2.0.
-            auto scale = 1.0 / spp;
-            r = sqrt(scale * r);
-            g = sqrt(scale * g);
-            b = sqrt(scale * b);
-
-            framebuffer[(image_height - j - 1) * image_width + i] = Vector3f(r, g, b);
+            loopStats.Add(ThreadAllocations() - allocStart, ThreadRays() - rayStart);
         }
-        omp_set_lock(&lock);
-        UpdateProgress((m++) / (float)image_height);
-        omp_unset_lock(&lock);
+        progress.Done();
+        // the calling thread was pinned as thread 0, give it back all CPUs
+        if (pinThreads) PinThread(topology.AllCpus());
+    };
+
+    if (!options.coordinator.empty()) {
+        return RunWorker(options.coordinator, &film, spp, job.seed, job.adaptive,
+                         [&](const std::vector<Tile> &run, int sampleEnd) { renderTiles(run, 0, sampleEnd); });
+    }
+
+    // a time limited render may stop short of spp, it keeps its checkpoint to go on from
+    bool complete = true;
+    if (options.workers > 0) {
+        CoordinatorOptions coordinatorOptions;
+        coordinatorOptions.nWorkers = options.workers;
+        coordinatorOptions.port = options.port;
+        coordinatorOptions.program = options.remoteWorkers ? "" : options.program;
+        coordinatorOptions.workerThreads = options.nThreads;
+        coordinatorOptions.seed = job.seed;
+        coordinatorOptions.adaptive = job.adaptive;
+        coordinatorOptions.sampler = job.sampler;
+        if (!RunCoordinator(&film, tiles, spp, coordinatorOptions)) return false;
     }
-    UpdateProgress(1.);
-    omp_destroy_lock(&lock);
-
-    FILE *f = fopen("image.ppm", "w"); // Write image to PPM file.
-    fprintf(f, "P3\n%d %d\n%d\n", image_width, image_height, 255);
-    for (int i = 0; i < image_height * image_width; i++) {
-        fprintf(f, "%d %d %d ", static_cast<int>(256 * clamp(framebuffer[i].x, 0.0, 0.999)),
-                    static_cast<int>(256 * clamp(framebuffer[i].y, 0.0, 0.999)),
-                    static_cast<int>(256 * clamp(framebuffer[i].z, 0.0, 0.999)));
+    else if (!options.progressive)
+        renderTiles(tiles, 0, spp);
+    else {
+        for (int pass = 0, sampleEnd = 1; ; ++pass, sampleEnd *= 2) {
+            sampleEnd = std::min(sampleEnd, spp);
+            renderTiles(tiles, pass, sampleEnd);
+            film.WritePPM(job.outputFile);
+            if (options.checkpointInterval > 0) writeCheckpoint();
+            double error = film.MeanRelativeError();
+            bool deadline = outOfTime(pass);
+            std::cout << "Pass " << pass << ": " << sampleEnd << " spp" << (deadline ? " (cut short)" : "")
+                      << ", mean relative error " << error << ", " << elapsed() << " s\n";
+            complete = !deadline;
+            if (sampleEnd == spp || deadline || (options.targetError > 0 && error <= options.targetError))
+                break;
+        }
     }
-}
\ No newline at end of file
+
+    loopStats.samples = film.SampleCount();
+    if (adaptive)
+        std::cout << "Adaptive sampling: " << (double)loopStats.samples / (image_width * image_height) << " spp on average, "
+                  << 100.0 * loopStats.samples / ((double)image_width * image_height * spp) << "% of " << spp << " spp\n";
+    loopStats.Report();
+    // compare between runs: any thread count, tile order or worker split gives the same
+    std::cout << "Image hash: " << std::hex << film.Hash() << std::dec << "\n";
+
+    if (!options.progressive && !film.WritePPM(job.outputFile))
+        return false;
+    if (options.checkpointInterval > 0 && complete)
+        std::remove(checkpointFile.c_str());
+    return true;
+}
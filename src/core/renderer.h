@@ -4,15 +4,126 @@
 #include "scene.h"
 #include "integrator.h"
 #include "camera.h"
+#include "adaptive.h"
+#include "memory.h"
+#include "numa.h"
+#include "../accelerators/geometrycache.h"
+
+#include <string>
+
+// Settings that come from the command line, see main.cpp
+struct RenderOptions {
+    std::string outputFile = "image.ppm";
+    int nThreads = 0;   // 0 uses every processor
+    // Progressive rendering: passes of doubling spp over the whole image, the
+    // image on disk is replaced after every pass. Stops at the sampler's spp,
+    // after timeLimit seconds or once the mean relative error reaches
+    // targetError, whichever comes first (0 disables a limit).
+    bool progressive = false;
+    double timeLimit = 0;
+    double targetError = 0;
+    // NUMA: pin render threads to CPUs, filling one node before the next, and
+    // with replicateScene give every node its own copy of the BVH
+    bool pinThreads = false;
+    bool replicateScene = false;
+    // Distributed rendering, see distributed.h: with workers > 0 this process
+    // coordinates that many worker processes, spawned from program unless
+    // remoteWorkers is set, in which case they connect to port themselves.
+    // A worker connects to the coordinator at "host:port".
+    int workers = 0;
+    int port = 0;
+    bool remoteWorkers = false;
+    std::string program;
+    std::string coordinator;
+    // Server mode keeps the scenes of recent jobs loaded, dropping the least
+    // recently used ones once they take more than this together
+    size_t sceneCacheBytes = size_t(1) << 30;
+    // seed, samples per pixel (a power of two, 0 keeps the RenderJob
+    // default) and adaptive sampling of the default job
+    uint64_t seed = 0;
+    int spp = 0;
+    AdaptiveSettings adaptive;
+    std::string sampler;   // empty keeps the RenderJob default
+    // Every checkpointInterval seconds (0: never) and after every progressive
+    // pass the film is saved to <output>.checkpoint, which resume picks up
+    // again; the checkpoint is removed once the render is complete
+    double checkpointInterval = 0;
+    bool resume = false;
+};
+
+// One image of the scene; the defaults are the built-in view. Server mode
+// reads these from job lines, see server.h
+struct RenderJob {
+    std::string outputFile = "image.ppm";
+    int width = 600, height = 600;
+    int spp = 128;
+    AdaptiveSettings adaptive;
+    // every sample's random numbers depend only on pixel, sample index and
+    // seed, so the image is the same for any thread count, tile order or
+    // distributed split
+    uint64_t seed = 0;
+    std::string integrator = "path";   // or "volpath"
+    // "sobol", "halton", "stratified" or "independent"; sobol only takes a
+    // power of two spp, stratified splits spp into the squarest grid it can
+    std::string sampler = "sobol";
+    // mesh placed in the Cornell box, the scene cache is keyed on both
+    std::string model = "../models/bunny/bunny.obj";
+    float modelScale = 2000;
+    Point3f lookfrom = Point3f(278, 278, -800), lookat = Point3f(278, 278, 0);
+    Vector3f vup = Vector3f(0, 1, 0);
+    float vfov = 40, aperture = 0, focusDistance = 10;
+};
+
+// Hash of every RenderJob setting that changes the image, outputFile aside;
+// checkpoints and workers have to match it
+uint64_t JobKey(const RenderJob &job);
+
+// Sampler names a RenderJob takes
+bool IsSamplerName(const std::string &name);
+// false with a reason in error if job's spp does not suit its sampler
+bool CheckSamplerSpp(const RenderJob &job, std::string *error);
+
+// A built scene together with all the memory it lives in
+struct LoadedScene {
+    // owns the memory of the whole scene, so it has to go away last
+    SceneArena arena;
+    // per NUMA node BVH copies for options.replicateScene, same order rule
+    std::vector<std::unique_ptr<SceneArena>> replicaArenas;
+    std::unique_ptr<Scene> scene;
+    std::vector<std::unique_ptr<Scene>> replicas;
+
+    // The arenas plus the Scene objects. BuildScene makes everything else in
+    // the arenas, BVH leaf arrays and mesh attributes included; heap-backed
+    // images (Image_Texture, grid media, Perlin tables) would not be counted,
+    // it uses none
+    size_t Bytes() const;
+};
 
 class Renderer {
 public:
-    Renderer() {}
+    Renderer(const RenderOptions &options = RenderOptions())
+        : sceneCache(options.sceneCacheBytes), options(options) {}
+    // Builds the scene and renders the default job to options.outputFile
     void Render();
+
+    // The job's scene from the cache, built on a miss; nullptr if its model
+    // cannot be read. Jobs hold on to it, so evicting a scene in use is safe
+    std::shared_ptr<const LoadedScene> LoadScene(const RenderJob &job);
+    // false if the job could not be rendered or written
+    bool Render(const RenderJob &job);
+    void ReportSceneCache() const { sceneCache.Report("scenes"); }
+
+private:
+    std::shared_ptr<LoadedScene> BuildScene(const RenderJob &job);
+
+    GeometryCache<LoadedScene, std::string> sceneCache;
+    NumaTopology topology;
+
 public:
+    RenderOptions options;
     std::shared_ptr<Sampler> sampler;
     std::shared_ptr<camera> m_camera;
     std::shared_ptr<Integrator> integrator;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,69 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <algorithm>
+#include <cstdint>
+
+/*
+PCG32 random number generator (O'Neill, pcg-random.org), as in PBRT. Eight
+bytes of state per stream, so every render thread and every pixel can own
+an independent sequence without locking.
+*/
+
+static constexpr float FloatOneMinusEpsilon = 0x1.fffffep-1;
+
+#define PCG32_DEFAULT_STATE 0x853c49e6748fea9bULL
+#define PCG32_DEFAULT_STREAM 0xda3e39cb94b95bdbULL
+#define PCG32_MULT 0x5851f42d4c957f2dULL
+
+class RNG {
+public:
+    RNG() : state(PCG32_DEFAULT_STATE), inc(PCG32_DEFAULT_STREAM) {}
+    RNG(uint64_t sequenceIndex) { SetSequence(sequenceIndex); }
+
+    // Selects one of 2^63 independent streams and restarts it
+    void SetSequence(uint64_t initseq) {
+        state = 0u;
+        inc = (initseq << 1u) | 1u;
+        UniformUInt32();
+        state += PCG32_DEFAULT_STATE;
+        UniformUInt32();
+    }
+
+    uint32_t UniformUInt32() {
+        uint64_t oldstate = state;
+        state = oldstate * PCG32_MULT + inc;
+        uint32_t xorshifted = (uint32_t)(((oldstate >> 18u) ^ oldstate) >> 27u);
+        uint32_t rot = (uint32_t)(oldstate >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((~rot + 1u) & 31));
+    }
+
+    // Uniform in [0, b) without modulo bias
+    uint32_t UniformUInt32(uint32_t b) {
+        uint32_t threshold = (~b + 1u) % b;
+        while (true) {
+            uint32_t r = UniformUInt32();
+            if (r >= threshold) return r % b;
+        }
+    }
+
+    // Uniform in [0, 1)
+    float UniformFloat() {
+        return std::min(FloatOneMinusEpsilon, UniformUInt32() * 0x1p-32f);
+    }
+
+private:
+    uint64_t state, inc;
+};
+
+inline uint64_t MixBits(uint64_t v)
+{
+    v ^= (v >> 31);
+    v *= 0x7fb5d329728ea185ull;
+    v ^= (v >> 27);
+    v *= 0x81dadef4bc2dd44dull;
+    v ^= (v >> 33);
+    return v;
+}
+
+#endif
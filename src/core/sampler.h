@@ -2,28 +2,62 @@
 #define SAMPLER_H
 
 #include "vector.h"
+#include "rng.h"
 
-#include <random>
+#include <memory>
+
+/*
+Samplers are not shared between threads: the renderer clones one per thread,
+restarts it at every pixel and at every sample of that pixel. Each call to
+Next1D() / Next2D() consumes the next dimension of the current sample, so
+integrators must draw their numbers in the same order for every sample.
+A sample's values only depend on pixel, sample index and seed, never on which
+thread rendered it or in which order.
+*/
 
 class Sampler {
 public:
-    Sampler() {}
+    Sampler(int samplesPerPixel, uint64_t seed = 0) : samplesPerPixel(samplesPerPixel), seed(seed) {}
+    virtual ~Sampler() {}
+
+    virtual std::unique_ptr<Sampler> Clone() const = 0;
+
+    // Restarts at sample 0 of pixel (x, y)
+    void StartPixel(int x, int y) {
+        pixelX = x;
+        pixelY = y;
+        StartSample(0);
+    }
 
-    virtual void Setup(uint64_t s) {
-        engine.seed(s);
+    // Jumps to sample sampleIndex of the current pixel, at dimension 0
+    virtual void StartSample(int sampleIndex) {
+        currentSample = sampleIndex;
+        dimension = 0;
     }
 
-    virtual float Next1D() {
-        return rng(engine);
+    bool StartNextSample() {
+        StartSample(currentSample + 1);
+        return currentSample < samplesPerPixel;
     }
 
-    virtual Vector2f Next2D() {
-        return Vector2f(Next1D(), Next1D());
+    virtual float Next1D() = 0;
+    virtual Vector2f Next2D() = 0;
+
+    int SamplesPerPixel() const { return samplesPerPixel; }
+    int CurrentSample() const { return currentSample; }
+    int Dimension() const { return dimension; }
+
+protected:
+    // Hash of pixel, seed and (a, stream), used to decorrelate pixels, samples and dimensions
+    uint64_t PixelHash(uint64_t a, uint64_t stream = 0) const {
+        uint64_t pixel = (uint64_t)(uint32_t)pixelY << 32 | (uint32_t)pixelX;
+        return MixBits(MixBits(MixBits(pixel ^ seed) ^ a) ^ stream);
     }
 
-private:
-    std::default_random_engine engine;
-    std::uniform_real_distribution<float> rng;
+    const int samplesPerPixel;
+    const uint64_t seed;
+    int pixelX = 0, pixelY = 0;
+    int currentSample = 0, dimension = 0;
 };
 
-#endif
\ No newline at end of file
+#endif
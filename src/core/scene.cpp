@@ -1,21 +1,27 @@
 #include "scene.h"
+#include "allocstats.h"
 
-bool Scene::Intersect(const Ray &ray, HitRecord &isect) const {
-    HitRecord temp_isect;
+bool Scene::IntersectHit(const Ray &ray, RawHit &hit) const {
+    CountRay();
     bool hit_anything = false;
-    auto closest = INF;
     for (const auto &object : objects) {
-        if (object->Intersect(ray, temp_isect)) {
+        if (object->IntersectHit(ray, hit))
             hit_anything = true;
-            closest = temp_isect.t;
-            isect = temp_isect;
-        }
     }
     return hit_anything;
 }
 
+bool Scene::Intersect(const Ray &ray, HitRecord &isect) const {
+    RawHit hit;
+    if (!IntersectHit(ray, hit)) return false;
+    // only the closest hit is turned into a full surface interaction
+    hit.primitive->ComputeSurfaceInteraction(ray, hit, isect);
+    return true;
+}
+
 bool Scene::IntersectTr(Ray ray, Sampler &sampler, HitRecord &isect, Spectrum *Tr) const {
     *Tr = Spectrum(1.f);
+    ray.skipPassThrough = true;
     while (true) {
         bool hitSurface = Intersect(ray, isect);
         if (ray.medium) {
@@ -23,6 +29,8 @@ bool Scene::IntersectTr(Ray ray, Sampler &sampler, HitRecord &isect, Spectrum *T
         }
         if (!hitSurface) return false;
         if (isect.mat_ptr != nullptr) return true;
-        ray = Ray(isect.p + ray.d * 0.0001, ray.d, Infinity, 0.f, ray.medium);
+        // material-less geometry without a filter still has to be stepped over
+        ray = isect.SpawnRay(ray.d, ray.medium);
+        ray.skipPassThrough = true;
     }
 }
\ No newline at end of file
@@ -7,14 +7,26 @@
 
 class Scene {
 public:
-    Scene(std::vector<std::shared_ptr<Object>> objects, std::vector<std::shared_ptr<Light>> lights)
-        : objects(objects), lights(lights) {}
+    // nothing passed in is owned, the scene's arena owns it all
+    Scene(std::vector<const Object *> objects, std::vector<const Light *> lights,
+          std::vector<const Medium *> media = {})
+        : objects(objects), lights(lights), media(media) {}
 
+    // Closest hit only, enough for occlusion tests
+    bool IntersectHit(const Ray &ray, RawHit &hit) const;
     bool Intersect(const Ray &ray, HitRecord &isect) const;
     bool IntersectTr(Ray ray, Sampler &sampler, HitRecord &isect, Spectrum *transmittance) const;
+
+    // the Scene and its lists, which live on the heap; not what they point to
+    size_t Bytes() const {
+        return sizeof(Scene) + objects.capacity() * sizeof(objects[0]) + lights.capacity() * sizeof(lights[0]) +
+               media.capacity() * sizeof(media[0]);
+    }
 public:
-    std::vector<std::shared_ptr<Object>> objects;
-    std::vector<std::shared_ptr<Light>> lights;
+    std::vector<const Object *> objects;
+    std::vector<const Light *> lights;
+    // every medium referenced by rays and hit records
+    std::vector<const Medium *> media;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "scheduler.h"
+
+#include <algorithm>
+
+// Hilbert curve index d to (x, y) on an n x n grid, n a power of two
+static void HilbertToXY(int n, int d, int *x, int *y) {
+    *x = *y = 0;
+    for (int s = 1; s < n; s *= 2) {
+        int rx = 1 & (d / 2);
+        int ry = 1 & (d ^ rx);
+        if (ry == 0) {
+            if (rx == 1) {
+                *x = s - 1 - *x;
+                *y = s - 1 - *y;
+            }
+            std::swap(*x, *y);
+        }
+        *x += s * rx;
+        *y += s * ry;
+        d /= 4;
+    }
+}
+
+std::vector<Tile> HilbertTiles(int width, int height, int tileSize) {
+    int nx = (width + tileSize - 1) / tileSize, ny = (height + tileSize - 1) / tileSize;
+    int n = 1;
+    while (n < std::max(nx, ny)) n *= 2;
+
+    std::vector<Tile> tiles;
+    tiles.reserve((size_t)nx * ny);
+    for (int d = 0; d < n * n; ++d) {
+        int tx, ty;
+        HilbertToXY(n, d, &tx, &ty);
+        if (tx >= nx || ty >= ny) continue;
+        tiles.push_back(Tile{tx * tileSize, ty * tileSize,
+                             std::min((tx + 1) * tileSize, width), std::min((ty + 1) * tileSize, height)});
+    }
+    return tiles;
+}
+
+int RenderThreadCount(int requested) {
+    return requested > 0 ? requested : std::max(1, omp_get_num_procs());
+}
+
+TileScheduler::TileScheduler(const std::vector<Tile> &tiles, int nThreads)
+    : queues(new Queue[nThreads]), nThreads(nThreads) {
+    // contiguous runs of the curve, so each thread starts on a compact region
+    for (size_t i = 0; i < tiles.size(); ++i)
+        queues[i * nThreads / tiles.size()].tiles.push_back(tiles[i]);
+}
+
+bool TileScheduler::Next(int thread, Tile *tile) {
+    {
+        Queue &own = queues[thread];
+        std::lock_guard<std::mutex> guard(own.mutex);
+        if (!own.tiles.empty()) {
+            *tile = own.tiles.front();
+            own.tiles.pop_front();
+            return true;
+        }
+    }
+    // steal from the far end of the next non-empty queue, away from its owner
+    for (int k = 1; k < nThreads; ++k) {
+        Queue &victim = queues[(thread + k) % nThreads];
+        std::lock_guard<std::mutex> guard(victim.mutex);
+        if (!victim.tiles.empty()) {
+            *tile = victim.tiles.back();
+            victim.tiles.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
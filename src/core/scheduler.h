@@ -0,0 +1,46 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "global.h"
+
+#include <deque>
+#include <mutex>
+
+/*
+tile scheduling for the render loop. Tiles are laid out along a Hilbert
+curve, so consecutive tiles are neighbours in the image, and dealt out to the
+threads in contiguous runs. A thread works through its own run from the front
+and, once that is empty, steals from the back of another thread's run, so
+expensive regions (glass, caustics) no longer leave cores idle at the end.
+*/
+
+struct Tile {
+    int x0, y0, x1, y1;   // pixel bounds, x1 and y1 exclusive
+    int Width() const { return x1 - x0; }
+    int Height() const { return y1 - y0; }
+};
+
+// tileSize x tileSize tiles covering the image, in Hilbert curve order
+std::vector<Tile> HilbertTiles(int width, int height, int tileSize);
+
+// Threads to render with: requested if positive, all available processors otherwise
+int RenderThreadCount(int requested);
+
+class TileScheduler {
+public:
+    TileScheduler(const std::vector<Tile> &tiles, int nThreads);
+
+    // Next tile for thread, false once every queue is empty
+    bool Next(int thread, Tile *tile);
+
+private:
+    // one cache line per queue so owners do not contend on their locks
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<Tile> tiles;
+    };
+    std::unique_ptr<Queue[]> queues;
+    const int nThreads;
+};
+
+#endif
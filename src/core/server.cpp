@@ -0,0 +1,150 @@
+#include "server.h"
+#include "net.h"
+
+#include <cstdio>
+#include <sstream>
+
+static bool ParseFloats(const std::string &value, float *v, int n) {
+    std::stringstream ss(value);
+    std::string item;
+    int i = 0;
+    for (; i < n && std::getline(ss, item, ','); ++i) {
+        char *end;
+        v[i] = strtof(item.c_str(), &end);
+        if (item.empty() || *end) return false;
+    }
+    return i == n && !std::getline(ss, item, ',');
+}
+
+bool ParseRenderJob(const std::string &line, RenderJob *job, std::string *error) {
+    std::stringstream ss(line);
+    std::string setting;
+    while (ss >> setting) {
+        size_t eq = setting.find('=');
+        if (eq == std::string::npos) {
+            *error = "expected key=value, got '" + setting + "'";
+            return false;
+        }
+        std::string key = setting.substr(0, eq), value = setting.substr(eq + 1);
+        float v[3] = {0, 0, 0};
+        bool ok = true;
+        if (key == "output")
+            job->outputFile = value;
+        else if (key == "model")
+            job->model = value;
+        else if (key == "scale") {
+            ok = ParseFloats(value, v, 1) && v[0] > 0;
+            job->modelScale = v[0];
+        }
+        else if (key == "sampler") {
+            job->sampler = value;
+            ok = IsSamplerName(value);
+        }
+        else if (key == "integrator") {
+            job->integrator = value;
+            ok = value == "path" || value == "volpath";
+        }
+        else if (key == "seed") {
+            char *end;
+            job->seed = strtoull(value.c_str(), &end, 10);
+            ok = !value.empty() && !*end;
+        }
+        else if (key == "width" || key == "height" || key == "spp") {
+            int n = atoi(value.c_str());
+            (key == "width" ? job->width : key == "height" ? job->height : job->spp) = n;
+            ok = n > 0;
+        }
+        else if (key == "adaptive") {
+            job->adaptive.enabled = value == "1";
+            ok = value == "0" || value == "1";
+        }
+        else if (key == "minspp") {
+            job->adaptive.minSpp = atoi(value.c_str());
+            ok = job->adaptive.minSpp > 0;
+        }
+        else if (key == "adaptiveerror") {
+            ok = ParseFloats(value, v, 1) && v[0] > 0;
+            job->adaptive.maxRelativeError = v[0];
+        }
+        else if (key == "lookfrom" || key == "lookat" || key == "vup") {
+            ok = ParseFloats(value, v, 3);
+            if (key == "lookfrom") job->lookfrom = Point3f(v[0], v[1], v[2]);
+            else if (key == "lookat") job->lookat = Point3f(v[0], v[1], v[2]);
+            else job->vup = Vector3f(v[0], v[1], v[2]);
+        }
+        else if (key == "fov" || key == "aperture" || key == "focus") {
+            ok = ParseFloats(value, v, 1);
+            (key == "fov" ? job->vfov : key == "aperture" ? job->aperture : job->focusDistance) = v[0];
+        }
+        else {
+            *error = "unknown setting '" + key + "'";
+            return false;
+        }
+        if (!ok) {
+            *error = "bad value for " + key + ": '" + value + "'";
+            return false;
+        }
+    }
+    // spp and sampler may come in any order
+    return CheckSamplerSpp(*job, error);
+}
+
+// Runs one job line; the answer, without newline, goes to reply. False for "quit"
+static bool HandleLine(Renderer &renderer, const std::string &line, std::string *reply) {
+    reply->clear();
+    size_t first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') return true;
+    if (line.compare(first, 4, "quit") == 0) return false;
+
+    RenderJob job;
+    std::string error;
+    if (!ParseRenderJob(line, &job, &error)) {
+        *reply = "error " + error;
+        return true;
+    }
+    auto start = std::chrono::steady_clock::now();
+    if (!renderer.Render(job)) {
+        *reply = "error could not render " + job.outputFile;
+        return true;
+    }
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    *reply = "ok " + job.outputFile + " " + std::to_string(seconds.count());
+    return true;
+}
+
+void Serve(Renderer &renderer, std::istream &in) {
+    // stdout carries the protocol alone, whatever the renderer prints goes to stderr meanwhile
+    std::ostream replies(std::cout.rdbuf());
+    std::streambuf *stdoutBuffer = std::cout.rdbuf(std::cerr.rdbuf());
+    renderer.LoadScene(RenderJob());
+    replies << "ready\n" << std::flush;
+    std::string line, reply;
+    while (std::getline(in, line) && HandleLine(renderer, line, &reply))
+        if (!reply.empty()) replies << reply << "\n" << std::flush;
+    renderer.ReportSceneCache();
+    std::cout.rdbuf(stdoutBuffer);
+}
+
+bool ServeSocket(Renderer &renderer, const std::string &path) {
+    Socket listener = Socket::ListenUnix(path);
+    if (!listener.Valid()) return false;
+    renderer.LoadScene(RenderJob());
+    std::cout << "Serving on " << path << "\n" << std::flush;
+
+    bool quit = false;
+    while (!quit) {
+        Socket client = listener.Accept();
+        if (!client.Valid()) continue;
+        std::string line, reply;
+        while (client.RecvLine(&line)) {
+            if (!HandleLine(renderer, line, &reply)) {
+                quit = true;
+                break;
+            }
+            if (!reply.empty() && !client.SendLine(reply)) break;
+        }
+    }
+    std::remove(path.c_str());
+    renderer.ReportSceneCache();
+    return true;
+}
@@ -0,0 +1,32 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "renderer.h"
+
+#include <istream>
+
+/*
+render server: the scene and its BVHs are built once, then every job line
+renders one image with them. A job line is a list of key=value settings,
+anything left out keeps the RenderJob default:
+
+    output=turntable_017.ppm width=800 height=600 spp=256 integrator=volpath sampler=sobol
+    lookfrom=278,278,-800 lookat=278,278,0 vup=0,1,0 fov=40 aperture=0 focus=10
+    adaptive=1 minspp=16 adaptiveerror=0.1
+
+With the sobol sampler, spp has to be a power of two.
+Empty lines and lines starting with # are skipped, "quit" stops the server.
+Every job is answered with one line, "ok <file> <seconds>" or "error <why>".
+*/
+
+// false with a reason in error for unknown keys or malformed values
+bool ParseRenderJob(const std::string &line, RenderJob *job, std::string *error);
+
+// Jobs from in, answers on std::cout, until "quit" or the end of in. Nothing
+// else reaches std::cout meanwhile, the renderer's reports go to std::cerr
+void Serve(Renderer &renderer, std::istream &in);
+
+// Jobs from clients of a Unix domain socket at path, one connection at a time
+bool ServeSocket(Renderer &renderer, const std::string &path);
+
+#endif
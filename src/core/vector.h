@@ -489,6 +489,21 @@ template <typename T, typename U> inline Bounds3<T> Expand(const Bounds3<T> &b,
                       b.pMax + Vector3<T>(delta, delta, delta));
 }
 
+// Moves p just past its error bounds along n, onto the side w points to, so a
+// ray leaving there cannot re-intersect the surface it starts on
+inline Point3f OffsetRayOrigin(const Point3f &p, const Vector3f &pError,
+                               const Vector3f &n, const Vector3f &w) {
+    float d = Dot(Abs(n), pError);
+    Vector3f offset = n * d;
+    if (Dot(w, n) < 0) offset = -offset;
+    Point3f po = p + offset;
+    for (int i = 0; i < 3; ++i) {
+        if (offset[i] > 0) po[i] = NextFloatUp(po[i]);
+        else if (offset[i] < 0) po[i] = NextFloatDown(po[i]);
+    }
+    return po;
+}
+
 inline Vector3f random_in_unit_sphere()
 {
     while (true)
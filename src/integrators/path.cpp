@@ -1,11 +1,14 @@
 #include "path.h"
 
-Spectrum PathIntegrator::Li(const Ray &r, const Scene &scene, Sampler &sampler) const {
+Spectrum PathIntegrator::Li(const Ray &r, const Scene &scene, Sampler &sampler, MemoryArena &arena) const {
     Spectrum L(0.f), beta(1.f);
     Ray ray(r);
     bool specularBounce = false;
     for (int bounces = 0; ; ++bounces) {
         HitRecord isect;
+        // only camera and specular paths look at emitters directly, the others step
+        // over pass-through geometry inside traversal
+        ray.skipPassThrough = !(bounces == 0 || specularBounce);
         bool foundIntersection = scene.Intersect(ray, isect);
         if (bounces == 0 || specularBounce) {
             if (foundIntersection && !isect.mat_ptr)
@@ -20,12 +23,13 @@ Spectrum PathIntegrator::Li(const Ray &r, const Scene &scene, Sampler &sampler)
             break;
 
         if (!isect.mat_ptr) {
-            ray = Ray(isect.p + ray.d * 0.0001, ray.d, INF, 0.f, ray.medium);
+            ray = isect.SpawnRay(ray.d, ray.medium);
             bounces --;
             continue;
         }
         
-        isect.mat_ptr->ComputeScatteringFunctions(&isect, TransportMode::Radiance);
+        isect.ComputeShadingGeometry();
+        isect.mat_ptr->ComputeScatteringFunctions(&isect, arena, TransportMode::Radiance);
 
         //std::cout << UniformSampleOneLight(ray, isect, scene, sampler, false) << std::endl;
         L += beta * UniformSampleOneLight(ray, isect, scene, sampler, false);
@@ -37,13 +41,13 @@ Spectrum PathIntegrator::Li(const Ray &r, const Scene &scene, Sampler &sampler)
 
         if (f.IsBlack() || pdf == 0.f)
             break;
-        beta *= f * AbsDot(wi, isect.normal) / pdf;
+        beta *= f * AbsDot(wi, isect.shadingNormal) / pdf;
         specularBounce = (flags & BSDF_SPECULAR) != 0;
-        ray = Ray(isect.p, wi);
+        ray = isect.SpawnRay(wi);
 
         if (bounces > 3) {
             float q = std::max((float).05, 1 - beta.y());
-            if (random_double(0.f, 1.f) < q)
+            if (sampler.Next1D() < q)
                 break;
             beta /= 1 - q;
         }
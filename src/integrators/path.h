@@ -9,7 +9,7 @@ public:
                    std::shared_ptr<Sampler> sampler)
                 : Integrator(camera, sampler), maxDepth(maxDepth) {}
     
-    Spectrum Li(const Ray &ray, const Scene &scene, Sampler &sampler) const;
+    Spectrum Li(const Ray &ray, const Scene &scene, Sampler &sampler, MemoryArena &arena) const;
 private:
     const int maxDepth;
 };
@@ -1,11 +1,12 @@
 #include "volpath.h"
 
-Spectrum VolPathIntegrator::Li(const Ray &r, const Scene &scene, Sampler &sampler) const {
+Spectrum VolPathIntegrator::Li(const Ray &r, const Scene &scene, Sampler &sampler, MemoryArena &arena) const {
     Spectrum L(0.f), beta(1.f);
     Ray ray(r);
     bool specularBounce = false;
     for (int bounces = 0; ; ++bounces) {
         HitRecord isect;
+        ray.skipPassThrough = !(bounces == 0 || specularBounce);
         bool foundIntersection = scene.Intersect(ray, isect);
 
         HitRecord mi;
@@ -19,7 +20,7 @@ Spectrum VolPathIntegrator::Li(const Ray &r, const Scene &scene, Sampler &sample
             L += beta * UniformSampleOneLight(ray, mi, scene, sampler, true);
             Vector3f wo = -ray.d, wi;
             mi.mediumRecord.phase->Sample_p(wo, &wi, sampler.Next2D());
-            ray = Ray(mi.p, wi, INF, 0.f, ray.medium);
+            ray = mi.SpawnRay(wi, ray.medium);
             specularBounce = false;
         }
         else {
@@ -35,11 +36,12 @@ Spectrum VolPathIntegrator::Li(const Ray &r, const Scene &scene, Sampler &sample
                 break;
 
             if (!isect.mat_ptr) {
-                ray = Ray(isect.p + ray.d * 0.0001, ray.d, INF, 0.f, ray.medium);
+                ray = isect.SpawnRay(ray.d, ray.medium);
                 bounces --;
                 continue;
             }
-            isect.mat_ptr->ComputeScatteringFunctions(&isect, TransportMode::Radiance);
+            isect.ComputeShadingGeometry();
+            isect.mat_ptr->ComputeScatteringFunctions(&isect, arena, TransportMode::Radiance);
 
             L += beta * UniformSampleOneLight(ray, isect, scene, sampler, true);
 
@@ -50,9 +52,9 @@ Spectrum VolPathIntegrator::Li(const Ray &r, const Scene &scene, Sampler &sample
 
             if (f.IsBlack() || pdf == 0.f)
                 break;
-            beta *= f * AbsDot(wi, isect.normal) / pdf;
+            beta *= f * AbsDot(wi, isect.shadingNormal) / pdf;
             specularBounce = (flags & BSDF_SPECULAR) != 0;
-            ray = Ray(isect.p, wi, INF, 0.0f, isect.GetMedium(wi));
+            ray = isect.SpawnRay(wi, isect.GetMedium(wi));
         }
 
         if (bounces > 3) {
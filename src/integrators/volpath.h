@@ -8,7 +8,7 @@ public:
     VolPathIntegrator(int maxDepth, std::shared_ptr<Camera> camera,
                    std::shared_ptr<Sampler> sampler)
                    : Integrator(camera, sampler), maxDepth(maxDepth) {}
-    Spectrum Li(const Ray &ray, const Scene &scene, Sampler &sampler) const;
+    Spectrum Li(const Ray &ray, const Scene &scene, Sampler &sampler, MemoryArena &arena) const;
     
 private:
     const int maxDepth;
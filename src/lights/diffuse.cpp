@@ -1,6 +1,6 @@
 #include "diffuse.h"
 
-DiffuseAreaLight::DiffuseAreaLight(const Spectrum &Le, int nSamples, const std::shared_ptr<Object> &object, bool twoSided)
+DiffuseAreaLight::DiffuseAreaLight(const Spectrum &Le, int nSamples, const Object *object, bool twoSided)
     : AreaLight(nSamples), Lemit(Le), shape(object), twoSided(twoSided), area(object->area) {}
 
 Spectrum DiffuseAreaLight::Power() const {
@@ -8,13 +8,13 @@ Spectrum DiffuseAreaLight::Power() const {
 }
 
 Spectrum DiffuseAreaLight::Sample_Li(const HitRecord &ref, const Point2f &u, Vector3f *wi, float *pdf, VisibilityTester *vis) const {
-    Vector3f dir = shape->random(ref.p);
+    Vector3f dir = shape->random(ref.p, u);
     *wi = Normalize(dir);
     *pdf = shape->pdf_value(ref.p, *wi);
     HitRecord it;
-    bool hit = shape->Intersect(Ray(ref.p, *wi), it);
-    *vis = VisibilityTester(ref.p, it.p);
+    bool hit = shape->Intersect(ref.SpawnRay(*wi), it);
     if (*pdf == 0 || !hit) return Spectrum(0.f);
+    *vis = VisibilityTester(ref, it);
     //std::cout << shape->pdf_value(ref.p, *wi) << std::endl;
     return L(it, -*wi);
 }
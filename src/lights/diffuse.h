@@ -5,7 +5,7 @@
 
 class DiffuseAreaLight : public AreaLight {
 public:
-    DiffuseAreaLight(const Spectrum &Le, int nSamples, const std::shared_ptr<Object> &object, bool twoSided = false);
+    DiffuseAreaLight(const Spectrum &Le, int nSamples, const Object *object, bool twoSided = false);
     Spectrum L(const HitRecord &intr, const Vector3f &w) const {
         return (twoSided || Dot(intr.normal, w) > 0) ? Lemit : Spectrum(0.f);
     }
@@ -16,7 +16,7 @@ public:
     void Pdf_Le(const Ray &, const Vector3f &, float *pdfPos, float *pdfDir) const;
 protected:
     const Spectrum Lemit;
-    std::shared_ptr<Object> shape;
+    const Object *shape;   // not owned
     const bool twoSided;
     const float area;
 };
@@ -1,7 +1,127 @@
 #include "../core/renderer.h"
+#include "../core/server.h"
+
+#include <cstring>
+
+static void Usage(const char *program) {
+    std::cerr << "usage: " << program << " [options]\n"
+              << "  -o <file>        output image (default image.ppm)\n"
+              << "  --threads <n>    render threads (default: all processors)\n"
+              << "  --progressive    render in passes of doubling spp, rewriting the image after each\n"
+              << "  --time <sec>     progressive, stop after this many seconds\n"
+              << "  --error <e>      progressive, stop once the mean relative error is below e\n"
+              << "  --checkpoint <sec>  save the render state every sec seconds to <output>.checkpoint\n"
+              << "  --resume         go on from <output>.checkpoint if there is one\n"
+              << "  --seed <n>       sampler seed (default 0); the image only depends on it, not on threads\n"
+              << "  --spp <n>        samples per pixel, a power of two with sobol (default 128)\n"
+              << "  --sampler <name> sobol (default), halton, stratified or independent\n"
+              << "  --adaptive       let converged pixels stop early; may bias dark, noisy pixels darker\n"
+              << "  --min-spp <n>    --adaptive, samples every pixel takes at least (default 16)\n"
+              << "  --adaptive-error <e>  --adaptive, relative error a pixel stops at (default 0.1)\n"
+              << "  --pin            pin render threads to CPUs, one NUMA node after the other\n"
+              << "  --replicate      --pin and a copy of the BVH on every NUMA node\n"
+              << "  --workers <n>    render with n worker processes, started on this machine\n"
+              << "  --listen <port>  with --workers, wait for the workers to connect on port instead\n"
+              << "  --worker <host:port>  render tiles for the coordinator at host:port\n"
+              << "  --serve          build the scene once, then render the jobs read from stdin\n"
+              << "  --serve-socket <path>  same, with jobs from a Unix domain socket at path\n"
+              << "  --scene-cache <MB>  server, memory for loaded scenes (default 1024)\n";
+}
+
 int main(int argc, char *argv[]) {
-    
-    Renderer r;
+
+    RenderOptions options;
+    bool serve = false;
+    std::string socketPath;
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "-o") && hasValue)
+            options.outputFile = argv[++i];
+        else if (!strcmp(argv[i], "--threads") && hasValue)
+            options.nThreads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--progressive"))
+            options.progressive = true;
+        else if (!strcmp(argv[i], "--time") && hasValue) {
+            options.timeLimit = atof(argv[++i]);
+            options.progressive = true;
+        }
+        else if (!strcmp(argv[i], "--error") && hasValue) {
+            options.targetError = atof(argv[++i]);
+            options.progressive = true;
+        }
+        else if (!strcmp(argv[i], "--checkpoint") && hasValue)
+            options.checkpointInterval = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--resume"))
+            options.resume = true;
+        else if (!strcmp(argv[i], "--seed") && hasValue)
+            options.seed = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--spp") && hasValue)
+            options.spp = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--sampler") && hasValue)
+            options.sampler = argv[++i];
+        else if (!strcmp(argv[i], "--adaptive"))
+            options.adaptive.enabled = true;
+        else if (!strcmp(argv[i], "--min-spp") && hasValue) {
+            options.adaptive.minSpp = atoi(argv[++i]);
+            options.adaptive.enabled = true;
+        }
+        else if (!strcmp(argv[i], "--adaptive-error") && hasValue) {
+            options.adaptive.maxRelativeError = atof(argv[++i]);
+            options.adaptive.enabled = true;
+        }
+        else if (!strcmp(argv[i], "--pin"))
+            options.pinThreads = true;
+        else if (!strcmp(argv[i], "--replicate"))
+            options.replicateScene = true;
+        else if (!strcmp(argv[i], "--workers") && hasValue)
+            options.workers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--listen") && hasValue) {
+            options.port = atoi(argv[++i]);
+            options.remoteWorkers = true;
+        }
+        else if (!strcmp(argv[i], "--worker") && hasValue)
+            options.coordinator = argv[++i];
+        else if (!strcmp(argv[i], "--serve"))
+            serve = true;
+        else if (!strcmp(argv[i], "--serve-socket") && hasValue)
+            socketPath = argv[++i];
+        else if (!strcmp(argv[i], "--scene-cache") && hasValue)
+            options.sceneCacheBytes = (size_t)atoi(argv[++i]) << 20;
+        else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    RenderJob defaultJob;
+    if (options.spp != 0) defaultJob.spp = options.spp;
+    if (!options.sampler.empty()) defaultJob.sampler = options.sampler;
+    std::string error;
+    if (!IsSamplerName(defaultJob.sampler))
+        error = "unknown sampler '" + defaultJob.sampler + "'";
+    else if (defaultJob.spp <= 0)
+        error = "--spp must be positive";
+    if (!error.empty() || !CheckSamplerSpp(defaultJob, &error)) {
+        std::cerr << "ERROR: " << error << ".\n";
+        return 1;
+    }
+    if (options.workers > 0 && (options.progressive || options.checkpointInterval > 0 || options.resume)) {
+        std::cerr << "ERROR: Progressive rendering and checkpoints do not work with --workers.\n";
+        return 1;
+    }
+#ifdef __linux__
+    options.program = "/proc/self/exe";
+#else
+    options.program = argv[0];
+#endif
+
+    Renderer r(options);
+    if (serve) {
+        Serve(r, std::cin);
+        return 0;
+    }
+    if (!socketPath.empty())
+        return ServeSocket(r, socketPath) ? 0 : 1;
 
     auto start = std::chrono::system_clock::now();
     r.Render();
@@ -13,4 +133,4 @@ int main(int argc, char *argv[]) {
     std::cout << "          : " << std::chrono::duration_cast<std::chrono::seconds>(stop - start).count() << " seconds\n";
 
     return 0;
-}
\ No newline at end of file
+}
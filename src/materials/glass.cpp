@@ -1,37 +1,33 @@
 #include "glass.h"
 
-void Glass::ComputeScatteringFunctions(HitRecord *si, TransportMode mode) const {
+void Glass::ComputeScatteringFunctions(HitRecord *si, MemoryArena &arena, TransportMode mode) const {
     float eta = index;
     float rough = roughness;
     Spectrum R = Kr;
     Spectrum T = Kt;
 
-    si->bsdf = std::make_shared<BSDF>(si->normal, eta);
+    si->bsdf = ARENA_ALLOC(arena, BSDF)(si->shadingNormal, eta);
 
     if (R.IsBlack() && T.IsBlack()) return;
 
     bool isSpecular = (rough == 0);
     if (!R.IsBlack()) {
-        auto fresnel = std::make_shared<FresnelDielectric>(1.f, eta);
+        FresnelDielectric fresnel(1.f, eta);
         if (isSpecular) {
-            auto specularReflection = std::make_shared<SpecularReflection>(R, fresnel);
-            si->bsdf->Add(specularReflection);
+            si->bsdf->Add(SpecularReflection(R, fresnel));
         }
         else {
-            auto distrib = std::make_shared<TrowbridgeReitzDistribution>(rough, rough);
-            auto microfacetReflection = std::make_shared<MicrofacetReflection>(R, distrib, fresnel);
-            si->bsdf->Add(microfacetReflection);
+            TrowbridgeReitzDistribution distrib(rough, rough);
+            si->bsdf->Add(MicrofacetReflection(R, distrib, fresnel));
         }
     }
     if (!T.IsBlack()) {
         if (isSpecular) {
-            auto specularTransmission = std::make_shared<SpecularTransmission>(T, 1.f, eta, mode);
-            si->bsdf->Add(specularTransmission);
+            si->bsdf->Add(SpecularTransmission(T, 1.f, eta, mode));
         }
         else {
-            auto distrib = std::make_shared<TrowbridgeReitzDistribution>(rough, rough);
-            auto microfacetTransmission = std::make_shared<MicrofacetTransmission>(T, distrib, 1.f, eta, mode);
-            si->bsdf->Add(microfacetTransmission);
+            TrowbridgeReitzDistribution distrib(rough, rough);
+            si->bsdf->Add(MicrofacetTransmission(T, distrib, 1.f, eta, mode));
         }
     }
 }
\ No newline at end of file
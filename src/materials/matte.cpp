@@ -1,11 +1,10 @@
 #include "matte.h"
 
-void Matte::ComputeScatteringFunctions(HitRecord *si, TransportMode mode) const {
+void Matte::ComputeScatteringFunctions(HitRecord *si, MemoryArena &arena, TransportMode mode) const {
     Spectrum r = Kd;
 
-    si->bsdf = std::make_shared<BSDF>(si->normal, 1);
+    si->bsdf = ARENA_ALLOC(arena, BSDF)(si->shadingNormal, 1);
     if (!r.IsBlack()) {
-        auto lam = std::make_shared<LambertionReflection>(r);
-        si->bsdf->Add(lam);
+        si->bsdf->Add(LambertionReflection(r));
     }
 }
\ No newline at end of file
@@ -6,7 +6,7 @@
 class Matte : public Material {
 public:
     Matte(const Spectrum &Kd, const float &sigma) : Kd(Kd), sigma(sigma) {}
-    virtual void ComputeScatteringFunctions(HitRecord *si, TransportMode mode) const override;
+    virtual void ComputeScatteringFunctions(HitRecord *si, MemoryArena &arena, TransportMode mode) const override;
 private:
     Spectrum Kd;
     float sigma;
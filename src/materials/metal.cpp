@@ -1,11 +1,9 @@
 #include "metal.h"
 
-void Metal::ComputeScatteringFunctions(HitRecord *si, TransportMode mode) const {
-    si->bsdf = std::make_shared<BSDF>(si->normal);
+void Metal::ComputeScatteringFunctions(HitRecord *si, MemoryArena &arena, TransportMode mode) const {
+    si->bsdf = ARENA_ALLOC(arena, BSDF)(si->shadingNormal);
 
-    auto frMf = std::make_shared<FresnelConductor>(1., eta, k);
-    auto distrib = std::make_shared<TrowbridgeReitzDistribution>(roughness, roughness);
-    auto metal = std::make_shared<MicrofacetReflection>(1., distrib, frMf);
-
-    si->bsdf->Add(metal);
+    FresnelConductor frMf(1., eta, k);
+    TrowbridgeReitzDistribution distrib(roughness, roughness);
+    si->bsdf->Add(MicrofacetReflection(1., distrib, frMf));
 }
\ No newline at end of file
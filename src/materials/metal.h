@@ -8,7 +8,7 @@ public:
     Metal(const Spectrum &eta, const Spectrum &k, float roughness)
         : eta(eta), k(k), roughness(roughness) {}
     
-    void ComputeScatteringFunctions(HitRecord *si, TransportMode mode) const;
+    void ComputeScatteringFunctions(HitRecord *si, MemoryArena &arena, TransportMode mode) const;
 private:
     const Spectrum eta, k;
     float roughness;
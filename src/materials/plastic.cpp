@@ -1,18 +1,16 @@
 #include "plastic.h"
 
-void Plastic::ComputeScatteringFunctions(HitRecord *si, TransportMode mode) const {
+void Plastic::ComputeScatteringFunctions(HitRecord *si, MemoryArena &arena, TransportMode mode) const {
     Spectrum kd = Kd;
-    si->bsdf = std::make_shared<BSDF>(si->normal);
+    si->bsdf = ARENA_ALLOC(arena, BSDF)(si->shadingNormal);
     if (!kd.IsBlack()) {
-        auto lam = std::make_shared<LambertionReflection>(kd);
-        si->bsdf->Add(lam);
+        si->bsdf->Add(LambertionReflection(kd));
     }
 
     Spectrum ks = Ks;
     if (!ks.IsBlack()) {
-        auto fresnel = std::make_shared<FresnelDielectric>(1.f, 1.5f);
-        auto distrib = std::make_shared<TrowbridgeReitzDistribution>(roughness, roughness);
-        auto spec = std::make_shared<MicrofacetReflection>(ks, distrib, fresnel);
-        si->bsdf->Add(spec);
+        FresnelDielectric fresnel(1.f, 1.5f);
+        TrowbridgeReitzDistribution distrib(roughness, roughness);
+        si->bsdf->Add(MicrofacetReflection(ks, distrib, fresnel));
     }
 }
\ No newline at end of file
@@ -7,7 +7,7 @@ class Plastic : public Material {
 public:
     Plastic(const Spectrum &Kd, const Spectrum &Ks, const float &roughness)
         : Kd(Kd), Ks(Ks), roughness(roughness) {}
-    void ComputeScatteringFunctions(HitRecord *si, TransportMode mode) const;
+    void ComputeScatteringFunctions(HitRecord *si, MemoryArena &arena, TransportMode mode) const;
 private:
     Spectrum Kd, Ks;
     float roughness;
@@ -13,7 +13,7 @@ Spectrum HomogeneousMedium::Sample(const Ray &ray, Sampler &sampler, HitRecord &
         it.t = t;
         it.p = ray(t);
         it.wo = -ray.d;
-        it.mediumRecord.phase = std::make_shared<HenyeyGreenstein>(g);
+        it.mediumRecord.phase = &phase;
     }
 
     Spectrum Tr = Exp(-sigma_t * std::min(t, MaxFloat) * ray.d.Length());
@@ -3,10 +3,11 @@
 class HomogeneousMedium : public Medium {
 public:
     HomogeneousMedium(const Spectrum &sigma_a, const Spectrum &sigma_s, float g)
-        : sigma_a(sigma_a), sigma_s(sigma_s), sigma_t(sigma_a + sigma_s), g(g) {}
+        : sigma_a(sigma_a), sigma_s(sigma_s), sigma_t(sigma_a + sigma_s), g(g), phase(g) {}
     Spectrum Tr(const Ray &ray, Sampler &sampler) const;
     Spectrum Sample(const Ray &ray, Sampler &sampler, HitRecord &it) const;
 private:
     const Spectrum sigma_a, sigma_s, sigma_t;
     const float g;
+    const HenyeyGreenstein phase;   // shared by every scattering event, see Sample()
 };
\ No newline at end of file
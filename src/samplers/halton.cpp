@@ -0,0 +1,15 @@
+#include "halton.h"
+#include "../core/lowdiscrepancy.h"
+
+float HaltonSampler::Next1D() {
+    // past the prime table the bases repeat, the scramble still differs per dimension
+    int baseIndex = dimension % PrimeTableSize;
+    float u = OwenScrambledRadicalInverse(baseIndex, currentSample, (uint32_t)PixelHash(dimension));
+    ++dimension;
+    return u;
+}
+
+Vector2f HaltonSampler::Next2D() {
+    float u0 = Next1D();
+    return Vector2f(u0, Next1D());
+}
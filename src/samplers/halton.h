@@ -0,0 +1,20 @@
+#ifndef SAMPLER_HALTON_H
+#define SAMPLER_HALTON_H
+
+#include "../core/sampler.h"
+
+// Halton sequence over the samples of a pixel, dimension d in base Primes[d],
+// Owen-scrambled per pixel so neighbouring pixels are decorrelated
+class HaltonSampler : public Sampler {
+public:
+    HaltonSampler(int samplesPerPixel, uint64_t seed = 0) : Sampler(samplesPerPixel, seed) {}
+
+    std::unique_ptr<Sampler> Clone() const override {
+        return std::unique_ptr<Sampler>(new HaltonSampler(*this));
+    }
+
+    float Next1D() override;
+    Vector2f Next2D() override;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef SAMPLER_INDEPENDENT_H
+#define SAMPLER_INDEPENDENT_H
+
+#include "../core/sampler.h"
+
+// Uniform random numbers, one PCG32 stream per pixel sample
+class IndependentSampler : public Sampler {
+public:
+    IndependentSampler(int samplesPerPixel, uint64_t seed = 0) : Sampler(samplesPerPixel, seed) {}
+
+    std::unique_ptr<Sampler> Clone() const override {
+        return std::unique_ptr<Sampler>(new IndependentSampler(*this));
+    }
+
+    void StartSample(int sampleIndex) override {
+        Sampler::StartSample(sampleIndex);
+        rng.SetSequence(PixelHash(sampleIndex));
+    }
+
+    float Next1D() override {
+        ++dimension;
+        return rng.UniformFloat();
+    }
+
+    Vector2f Next2D() override {
+        dimension += 2;
+        float u0 = rng.UniformFloat();
+        return Vector2f(u0, rng.UniformFloat());
+    }
+
+private:
+    RNG rng;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#include "sobol.h"
+#include "../core/lowdiscrepancy.h"
+
+static int RoundUpPow2(int v) {
+    int p = 1;
+    while (p < v) p <<= 1;
+    return p;
+}
+
+SobolSampler::SobolSampler(int samplesPerPixel, uint64_t seed)
+    : Sampler(RoundUpPow2(samplesPerPixel), seed) {
+    if (this->samplesPerPixel != samplesPerPixel)
+        std::cerr << "Sobol sampler: rounding " << samplesPerPixel << " samples per pixel up to "
+                  << this->samplesPerPixel << ".\n";
+}
+
+float SobolSampler::Next1D() {
+    uint64_t hash = PixelHash(dimension);
+    int index = PermutationElement(currentSample, samplesPerPixel, (uint32_t)hash);
+    ++dimension;
+    return SobolSample(index, 0, (uint32_t)(hash >> 32));
+}
+
+Vector2f SobolSampler::Next2D() {
+    uint64_t hash = PixelHash(dimension);
+    int index = PermutationElement(currentSample, samplesPerPixel, (uint32_t)hash);
+    dimension += 2;
+    return Vector2f(SobolSample(index, 0, (uint32_t)(hash >> 8)), SobolSample(index, 1, (uint32_t)(hash >> 32)));
+}
@@ -0,0 +1,22 @@
+#ifndef SAMPLER_SOBOL_H
+#define SAMPLER_SOBOL_H
+
+#include "../core/sampler.h"
+
+// Owen-scrambled Sobol points, padded: every 1D / 2D request uses the first
+// one / two Sobol dimensions with its own scramble and its own shuffle of the
+// sample order, so paths can use any number of dimensions. The sample count
+// is rounded up to a power of two, where the points are best stratified.
+class SobolSampler : public Sampler {
+public:
+    SobolSampler(int samplesPerPixel, uint64_t seed = 0);
+
+    std::unique_ptr<Sampler> Clone() const override {
+        return std::unique_ptr<Sampler>(new SobolSampler(*this));
+    }
+
+    float Next1D() override;
+    Vector2f Next2D() override;
+};
+
+#endif
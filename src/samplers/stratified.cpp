@@ -0,0 +1,23 @@
+#include "stratified.h"
+#include "../core/lowdiscrepancy.h"
+
+void StratifiedSampler::StartSample(int sampleIndex) {
+    Sampler::StartSample(sampleIndex);
+    rng.SetSequence(PixelHash(sampleIndex, 1));
+}
+
+float StratifiedSampler::Next1D() {
+    int stratum = PermutationElement(currentSample, samplesPerPixel, (uint32_t)PixelHash(dimension));
+    ++dimension;
+    float delta = jitter ? rng.UniformFloat() : 0.5f;
+    return (stratum + delta) / samplesPerPixel;
+}
+
+Vector2f StratifiedSampler::Next2D() {
+    int stratum = PermutationElement(currentSample, samplesPerPixel, (uint32_t)PixelHash(dimension));
+    dimension += 2;
+    int x = stratum % xPixelSamples, y = stratum / xPixelSamples;
+    float dx = jitter ? rng.UniformFloat() : 0.5f;
+    float dy = jitter ? rng.UniformFloat() : 0.5f;
+    return Vector2f((x + dx) / xPixelSamples, (y + dy) / yPixelSamples);
+}
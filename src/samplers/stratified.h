@@ -0,0 +1,29 @@
+#ifndef SAMPLER_STRATIFIED_H
+#define SAMPLER_STRATIFIED_H
+
+#include "../core/sampler.h"
+
+// One sample per stratum of an xPixelSamples x yPixelSamples grid (a 1D grid
+// of the same count for 1D dimensions), strata shuffled independently per
+// dimension and jittered inside
+class StratifiedSampler : public Sampler {
+public:
+    StratifiedSampler(int xPixelSamples, int yPixelSamples, bool jitter = true, uint64_t seed = 0)
+        : Sampler(xPixelSamples * yPixelSamples, seed), xPixelSamples(xPixelSamples), yPixelSamples(yPixelSamples),
+          jitter(jitter) {}
+
+    std::unique_ptr<Sampler> Clone() const override {
+        return std::unique_ptr<Sampler>(new StratifiedSampler(*this));
+    }
+
+    void StartSample(int sampleIndex) override;
+    float Next1D() override;
+    Vector2f Next2D() override;
+
+private:
+    const int xPixelSamples, yPixelSamples;
+    const bool jitter;
+    RNG rng;
+};
+
+#endif
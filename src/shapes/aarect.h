@@ -11,8 +11,8 @@ class XYRect : public Object
 {
 public:
     XYRect(double _x0, double _x1, double _y0, double _y1, double _k,
-            shared_ptr<Material> mat, std::shared_ptr<MediumRecord> mediumRecord = nullptr)
-        : x0(_x0), x1(_x1), y0(_y0), y1(_y1), k(_k), mp(mat), Object(mediumRecord){};
+            const Material *mat, const MediumRecord *mediumRecord = nullptr)
+        : x0(_x0), x1(_x1), y0(_y0), y1(_y1), k(_k), mp(mat), Object(mediumRecord, ShapeType::XYRect){};
 
     virtual bool hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const override;
 
@@ -23,10 +23,11 @@ public:
         output_box = AABB(Point3f(x0, y0, k - 0.0001), Point3f(x1, y1, k + 0.0001));
         return true;
     }
-    virtual bool Intersect(const Ray &ray, HitRecord &isect) const override;
+    virtual bool IntersectHit(const Ray &ray, RawHit &hit) const override;
+    virtual void ComputeSurfaceInteraction(const Ray &ray, const RawHit &hit, HitRecord &isect) const override;
 
 public:
-    shared_ptr<Material> mp;
+    const Material *mp;
     double x0, x1, y0, y1, k;
 };
 
@@ -35,8 +36,8 @@ class XZRect : public Object
 public:
 
     XZRect(double _x0, double _x1, double _z0, double _z1, double _k,
-            shared_ptr<Material> mat, std::shared_ptr<MediumRecord> mediumRecord = nullptr)
-        : x0(_x0), x1(_x1), z0(_z0), z1(_z1), k(_k), mp(mat), Object(mediumRecord){};
+            const Material *mat, const MediumRecord *mediumRecord = nullptr)
+        : x0(_x0), x1(_x1), z0(_z0), z1(_z1), k(_k), mp(mat), Object(mediumRecord, ShapeType::XZRect){};
 
     virtual bool hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const override;
 
@@ -62,15 +63,16 @@ public:
         //return 1.f / area;
     }
 
-    virtual Vector3f random(const Point3f &origin) const override
+    virtual Vector3f random(const Point3f &origin, const Point2f &u) const override
     {
-        auto random_point = Point3f(random_double(x0, x1), k, random_double(z0, z1));
+        auto random_point = Point3f(Lerp(u.x, x0, x1), k, Lerp(u.y, z0, z1));
         return random_point - origin;
     }
-    virtual bool Intersect(const Ray &ray, HitRecord &isect) const override;
+    virtual bool IntersectHit(const Ray &ray, RawHit &hit) const override;
+    virtual void ComputeSurfaceInteraction(const Ray &ray, const RawHit &hit, HitRecord &isect) const override;
 
 public:
-    shared_ptr<Material> mp;
+    const Material *mp;
     double x0, x1, z0, z1, k;
 };
 
@@ -79,8 +81,8 @@ class YZRect : public Object
 public:
 
     YZRect(double _y0, double _y1, double _z0, double _z1, double _k,
-            shared_ptr<Material> mat, std::shared_ptr<MediumRecord> mediumRecord = nullptr)
-        : y0(_y0), y1(_y1), z0(_z0), z1(_z1), k(_k), mp(mat), Object(mediumRecord){};
+            const Material *mat, const MediumRecord *mediumRecord = nullptr)
+        : y0(_y0), y1(_y1), z0(_z0), z1(_z1), k(_k), mp(mat), Object(mediumRecord, ShapeType::YZRect){};
 
     virtual bool hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const override;
 
@@ -91,10 +93,11 @@ public:
         output_box = AABB(Point3f(k - 0.0001, y0, z0), Point3f(k + 0.0001, y1, z1));
         return true;
     }
-    virtual bool Intersect(const Ray &ray, HitRecord &isect) const override;
+    virtual bool IntersectHit(const Ray &ray, RawHit &hit) const override;
+    virtual void ComputeSurfaceInteraction(const Ray &ray, const RawHit &hit, HitRecord &isect) const override;
 
 public:
-    shared_ptr<Material> mp;
+    const Material *mp;
     double y0, y1, z0, z1, k;
 };
 
@@ -117,24 +120,38 @@ bool XYRect::hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const
     return true;
 }
 
-bool XYRect::Intersect(const Ray &ray, HitRecord &isect) const {
+bool XYRect::IntersectHit(const Ray &ray, RawHit &hit) const {
     auto t = (k - ray.o.z) / ray.d.z;
-    if (t < 1 - ShadowEpsilon || t > ray.tMax)
+    if (t <= 0 || t > ray.tMax)
         return false;
     auto x = ray.o.x + t * ray.d.x;
     auto y = ray.o.y + t * ray.d.y;
     if (x < x0 || x > x1 || y < y0 || y > y1)
         return false;
-    isect.u = (x - x0) / (x1 - x0);
-    isect.v = (y - y0) / (y1 - y0);
+    hit.u = (x - x0) / (x1 - x0);
+    hit.v = (y - y0) / (y1 - y0);
     ray.tMax = t;
+    hit.t = t;
+    hit.primID = 0;
+    hit.primitive = this;
+    return true;
+}
+
+void XYRect::ComputeSurfaceInteraction(const Ray &ray, const RawHit &hit, HitRecord &isect) const {
+    float t = hit.t;
     isect.t = t;
+    isect.u = hit.u;
+    isect.v = hit.v;
     auto outward_normal = Vector3f(0, 0, 1);
     isect.set_face_normal(ray, outward_normal);
     isect.mat_ptr = mp;
+    // The plane coordinate is exact, only the in-plane ones carry error
     isect.p = ray(t);
+    isect.p.z = k;
+    isect.pError = gamma(4) * (Abs(ray.o) + Abs(ray.d * t));
+    isect.pError.z = 0;
     isect.wo = -ray.d;
-    return true;
+    isect.object = this;
 }
 
 bool XZRect::hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const
@@ -156,25 +173,38 @@ bool XZRect::hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const
     return true;
 }
 
-bool XZRect::Intersect(const Ray &ray, HitRecord &isect) const {
+bool XZRect::IntersectHit(const Ray &ray, RawHit &hit) const {
     auto t = (k - ray.o.y) / ray.d.y;
-    if (t < 1 - ShadowEpsilon || t > ray.tMax)
+    if (t <= 0 || t > ray.tMax)
         return false;
     auto x = ray.o.x + t * ray.d.x;
     auto z = ray.o.z + t * ray.d.z;
     if (x < x0 || x > x1 || z < z0 || z > z1)
         return false;
-    isect.u = (x - x0) / (x1 - x0);
-    isect.v = (z - z0) / (z1 - z0);
+    hit.u = (x - x0) / (x1 - x0);
+    hit.v = (z - z0) / (z1 - z0);
     ray.tMax = t;
+    hit.t = t;
+    hit.primID = 0;
+    hit.primitive = this;
+    return true;
+}
+
+void XZRect::ComputeSurfaceInteraction(const Ray &ray, const RawHit &hit, HitRecord &isect) const {
+    float t = hit.t;
     isect.t = t;
+    isect.u = hit.u;
+    isect.v = hit.v;
     auto outward_normal = Vector3f(0, 1, 0);
     isect.set_face_normal(ray, outward_normal);
     if (this->mp == nullptr) isect.normal = Vector3f(0, -1, 0);
     isect.mat_ptr = mp;
     isect.p = ray(t);
+    isect.p.y = k;
+    isect.pError = gamma(4) * (Abs(ray.o) + Abs(ray.d * t));
+    isect.pError.y = 0;
     isect.wo = -ray.d;
-    return true;
+    isect.object = this;
 }
 
 bool YZRect::hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const
@@ -196,24 +226,37 @@ bool YZRect::hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const
     return true;
 }
 
-bool YZRect::Intersect(const Ray &ray, HitRecord &isect) const {
+bool YZRect::IntersectHit(const Ray &ray, RawHit &hit) const {
     auto t = (k - ray.o.x) / ray.d.x;
-    if (t < 1 - ShadowEpsilon || t > ray.tMax)
+    if (t <= 0 || t > ray.tMax)
         return false;
     auto y = ray.o.y + t * ray.d.y;
     auto z = ray.o.z + t * ray.d.z;
     if (y < y0 || y > y1 || z < z0 || z > z1)
         return false;
-    isect.u = (y - y0) / (y1 - y0);
-    isect.v = (z - z0) / (z1 - z0);
+    hit.u = (y - y0) / (y1 - y0);
+    hit.v = (z - z0) / (z1 - z0);
     ray.tMax = t;
+    hit.t = t;
+    hit.primID = 0;
+    hit.primitive = this;
+    return true;
+}
+
+void YZRect::ComputeSurfaceInteraction(const Ray &ray, const RawHit &hit, HitRecord &isect) const {
+    float t = hit.t;
     isect.t = t;
+    isect.u = hit.u;
+    isect.v = hit.v;
     auto outward_normal = Vector3f(1, 0, 0);
     isect.set_face_normal(ray, outward_normal);
     isect.mat_ptr = mp;
     isect.p = ray(t);
+    isect.p.x = k;
+    isect.pError = gamma(4) * (Abs(ray.o) + Abs(ray.d * t));
+    isect.pError.x = 0;
     isect.wo = -ray.d;
-    return true;
+    isect.object = this;
 }
 
 #endif //RENDERER_AARECT_H
@@ -0,0 +1,388 @@
+#ifndef RENDERER_DISPLACED_H
+#define RENDERER_DISPLACED_H
+
+#include "../core/object.h"
+#include "triangle.h"
+#include "../core/hittable_list.h"
+#include "../core/global_stb_image.h"
+#include "../accelerators/bvh.h"
+#include "../accelerators/geometrycache.h"
+
+#include <algorithm>
+#include <atomic>
+
+/*
+displaced bilinear surface, split into patches whose micro-triangles are
+only generated when a ray reaches the patch bounds, then kept in a shared
+memory-bounded LRU cache
+*/
+
+class DisplacementMap
+{
+public:
+    DisplacementMap(int width, int height, const std::vector<float> &texels)
+        : width(width), height(height), texels(texels) {}
+
+    // 8-bit grayscale height image, mapped to [0, 1]
+    DisplacementMap(const std::string &filename)
+    {
+        int n;
+        unsigned char *data = stbi_load(filename.c_str(), &width, &height, &n, 1);
+        if (!data)
+        {
+            std::cerr << "ERROR: Could not load displacement map '" << filename << "'.\n";
+            width = height = 1;
+            texels.assign(1, 0.f);
+            return;
+        }
+        texels.resize(width * height);
+        for (int i = 0; i < width * height; ++i)
+            texels[i] = data[i] / 255.f;
+        stbi_image_free(data);
+    }
+
+    float Texel(int x, int y) const
+    {
+        x = Clamp(x, 0, width - 1);
+        y = Clamp(y, 0, height - 1);
+        return texels[y * width + x];
+    }
+
+    // bilinear lookup, uv in [0, 1]^2
+    float Evaluate(const Point2f &uv) const
+    {
+        float x = uv.x * width - 0.5f, y = uv.y * height - 0.5f;
+        int x0 = (int)std::floor(x), y0 = (int)std::floor(y);
+        float dx = x - x0, dy = y - y0;
+        return Lerp(dy, Lerp(dx, Texel(x0, y0), Texel(x0 + 1, y0)),
+                        Lerp(dx, Texel(x0, y0 + 1), Texel(x0 + 1, y0 + 1)));
+    }
+
+    // Conservative range of the bilinear reconstruction over a uv region: the min
+    // and max over every texel that contributes to it, which may be wider than the
+    // values the reconstruction actually reaches
+    void Range(const Bounds2f &uv, float *hMin, float *hMax) const
+    {
+        int x0 = (int)std::floor(uv.pMin.x * width - 0.5f), x1 = (int)std::floor(uv.pMax.x * width - 0.5f) + 1;
+        int y0 = (int)std::floor(uv.pMin.y * height - 0.5f), y1 = (int)std::floor(uv.pMax.y * height - 0.5f) + 1;
+        *hMin = Infinity;
+        *hMax = -Infinity;
+        for (int y = y0; y <= y1; ++y)
+            for (int x = x0; x <= x1; ++x)
+            {
+                float h = Texel(x, y);
+                *hMin = std::min(*hMin, h);
+                *hMax = std::max(*hMax, h);
+            }
+    }
+
+private:
+    int width, height;
+    std::vector<float> texels;
+};
+
+// Tessellated grid of one patch: (rate + 1)^2 vertices, 2 * rate^2 triangles
+struct MicroMesh
+{
+    int rate;
+    std::vector<Point3f> p;
+    std::vector<AABB> rowBounds;
+
+    const Point3f &P(int i, int j) const { return p[j * (rate + 1) + i]; }
+    size_t Bytes() const { return sizeof(MicroMesh) + p.size() * sizeof(Point3f) + rowBounds.size() * sizeof(AABB); }
+};
+
+typedef GeometryCache<MicroMesh> TessellationCache;
+
+// Per-thread front of the shared TessellationCache, so traversal resolves patches it
+// has seen recently without the cache lock. Slots keep their meshes alive, so up to
+// Slots meshes per thread can outlive an eviction from the shared cache.
+struct TessellationSlots
+{
+    static constexpr int Slots = 16;
+    uint64_t keys[Slots];
+    std::shared_ptr<const MicroMesh> meshes[Slots];
+    // mesh of the last patch that reported a hit, reused by ComputeSurfaceInteraction
+    uint64_t hitKey = ~0ull;
+    std::shared_ptr<const MicroMesh> hitMesh;
+
+    TessellationSlots() { std::fill(keys, keys + Slots, ~0ull); }
+    static int Slot(uint64_t key) { return (int)(((key * 0x9E3779B97F4A7C15ull) >> 32) % Slots); }
+};
+
+class DisplacedSurface;
+
+class DisplacedPatch : public Object
+{
+public:
+    DisplacedPatch(const DisplacedSurface *surface, uint64_t key, const Bounds2f &uvBounds, int rate, const AABB &box)
+        : surface(surface), key(key), uvBounds(uvBounds), rate(rate), box(box), Object(nullptr) {}
+
+    virtual bool hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const override;
+    virtual bool bounding_box(double time0, double time1, AABB &output_box) const override
+    {
+        output_box = box;
+        return true;
+    }
+    virtual bool IntersectHit(const Ray &ray, RawHit &hit) const override;
+    virtual void ComputeSurfaceInteraction(const Ray &ray, const RawHit &hit, HitRecord &isect) const override;
+
+public:
+    const DisplacedSurface *surface;
+    uint64_t key;   // surface id in the high bits, patch index in the low ones
+    Bounds2f uvBounds;
+    int rate;
+    AABB box;
+};
+
+class DisplacedSurface : public Object
+{
+public:
+    // p00, p10, p01, p11 are the corners of the base bilinear patch at uv (0,0), (1,0), (0,1), (1,1).
+    // Patches are tessellated at most maxRate quads per side, fewer where the
+    // height varies by less than tolerance (in world units).
+    DisplacedSurface(const Point3f &p00, const Point3f &p10, const Point3f &p01, const Point3f &p11,
+                     std::shared_ptr<DisplacementMap> map, float scale, int patchesPerSide, int maxRate, float tolerance,
+                     const Material *m, std::shared_ptr<TessellationCache> cache = nullptr,
+                     const MediumRecord *mediumRecord = nullptr)
+        : p00(p00), p10(p10), p01(p01), p11(p11), map(map), scale(scale), mat_ptr(m),
+          cache(cache ? cache : std::make_shared<TessellationCache>(DefaultCacheBytes)), id(nextId++),
+          Object(mediumRecord)
+    {
+        ObjectList list;
+        for (int j = 0; j < patchesPerSide; ++j)
+            for (int i = 0; i < patchesPerSide; ++i)
+            {
+                Bounds2f uv(Point2f((float)i / patchesPerSide, (float)j / patchesPerSide),
+                            Point2f((float)(i + 1) / patchesPerSide, (float)(j + 1) / patchesPerSide));
+                float hMin, hMax;
+                map->Range(uv, &hMin, &hMax);
+
+                int rate = 1;
+                float extent = (hMax - hMin) * std::abs(scale);
+                while (rate < maxRate && extent / rate > tolerance) rate *= 2;
+
+                // The base stays inside the hull of its corners. Cross(dpdu, dpdv) is bilinear,
+                // so it stays within r of its value at the centre, and the unit normal within
+                // 2r/|c| of the centre normal: zero for a flat patch, growing with its twist.
+                Point3f small(Infinity), big(-Infinity);
+                Vector3f c = BaseCross(uv.Lerp(Point2f(0.5f, 0.5f)));
+                float r = 0;
+                for (int k = 0; k < 4; ++k)
+                {
+                    Point2f cuv((k & 1) ? uv.pMax.x : uv.pMin.x, (k & 2) ? uv.pMax.y : uv.pMin.y);
+                    small = Min(small, BaseP(cuv));
+                    big = Max(big, BaseP(cuv));
+                    r = std::max(r, (BaseCross(cuv) - c).Length());
+                }
+                Vector3f n = Normalize(c);
+                Vector3f lo = Min(n * (hMin * scale), n * (hMax * scale));
+                Vector3f hi = Max(n * (hMin * scale), n * (hMax * scale));
+                float deviation = std::min(2.f, 2 * r / c.Length());
+                float reach = std::max(std::abs(hMin), std::abs(hMax)) * std::abs(scale);
+                small = small + lo;
+                big = big + hi;
+                Vector3f pad = Vector3f(0.0001f + deviation * reach) + (big - small) * 0.001f;
+                uint64_t key = ((uint64_t)id << 32) | (uint64_t)(j * patchesPerSide + i);
+                list.add(patchArena.New<DisplacedPatch>(this, key, uv, rate, AABB(small - pad, big + pad)));
+                nMicroTriangles += 2 * (size_t)rate * rate;
+            }
+        patches = patchArena.New<BVH>(list, 0, 1, patchArena);
+        area = Cross(p10 - p00, p01 - p00).Length();
+    }
+
+    virtual bool hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const override
+    {
+        return patches->hit(r, t_min, t_max, rec);
+    }
+    virtual bool bounding_box(double time0, double time1, AABB &output_box) const override
+    {
+        return patches->bounding_box(time0, time1, output_box);
+    }
+    virtual bool IntersectHit(const Ray &ray, RawHit &hit) const override
+    {
+        return patches->IntersectHit(ray, hit);
+    }
+
+    Point3f BaseP(const Point2f &uv) const
+    {
+        return Lerp(uv.y, Lerp(uv.x, p00, p10), Lerp(uv.x, p01, p11));
+    }
+    // unnormalized base normal; dpdu is linear in v and dpdv in u, so this is bilinear in uv
+    Vector3f BaseCross(const Point2f &uv) const
+    {
+        Vector3f dpdu = Lerp(uv.y, p10 - p00, p11 - p01);
+        Vector3f dpdv = Lerp(uv.x, p01 - p00, p11 - p10);
+        return Cross(dpdu, dpdv);
+    }
+    Vector3f BaseN(const Point2f &uv) const
+    {
+        return Normalize(BaseCross(uv));
+    }
+
+    // micro-triangles the patches would expand to if all were resident at once
+    size_t MicroTriangleCount() const { return nMicroTriangles; }
+    // Mesh of patch, owned by this thread's slots and valid until its next Tessellate()
+    const MicroMesh *Tessellate(const DisplacedPatch &patch) const;
+    // Pins mesh as the one ComputeSurfaceInteraction() will find for patch's hit
+    void RecordHit(const DisplacedPatch &patch) const;
+    // Mesh of the patch that reported hit, without another lookup when it is still pinned
+    const MicroMesh *HitMesh(const DisplacedPatch &patch) const;
+
+public:
+    static constexpr size_t DefaultCacheBytes = 256 << 20;
+
+    Point3f p00, p10, p01, p11;
+    std::shared_ptr<DisplacementMap> map;
+    float scale;
+    const Material *mat_ptr;
+    std::shared_ptr<TessellationCache> cache;
+    // the patches and their BVH, owned by the surface
+    SceneArena patchArena;
+    const BVH *patches;
+    size_t nMicroTriangles = 0;
+    // never reused, unlike addresses, so cache keys of a freed surface cannot alias a new one
+    uint32_t id;
+
+private:
+    static TessellationSlots &LocalSlots()
+    {
+        thread_local TessellationSlots slots;
+        return slots;
+    }
+    std::shared_ptr<MicroMesh> Build(const DisplacedPatch &patch) const;
+
+    static inline std::atomic<uint32_t> nextId{0};
+};
+
+const MicroMesh *DisplacedSurface::Tessellate(const DisplacedPatch &patch) const
+{
+    TessellationSlots &slots = LocalSlots();
+    int slot = TessellationSlots::Slot(patch.key);
+    if (slots.keys[slot] != patch.key)
+    {
+        slots.meshes[slot] = cache->Lookup(patch.key, [&]() { return Build(patch); });
+        slots.keys[slot] = patch.key;
+    }
+    return slots.meshes[slot].get();
+}
+
+void DisplacedSurface::RecordHit(const DisplacedPatch &patch) const
+{
+    TessellationSlots &slots = LocalSlots();
+    int slot = TessellationSlots::Slot(patch.key);
+    slots.hitKey = patch.key;
+    slots.hitMesh = slots.meshes[slot];
+}
+
+const MicroMesh *DisplacedSurface::HitMesh(const DisplacedPatch &patch) const
+{
+    TessellationSlots &slots = LocalSlots();
+    if (slots.hitKey == patch.key) return slots.hitMesh.get();
+    // the hit came from somewhere else (e.g. a caller-kept RawHit), resolve it again
+    return Tessellate(patch);
+}
+
+std::shared_ptr<MicroMesh> DisplacedSurface::Build(const DisplacedPatch &patch) const
+{
+    auto mesh = std::make_shared<MicroMesh>();
+    int rate = patch.rate;
+    mesh->rate = rate;
+    mesh->p.resize((rate + 1) * (rate + 1));
+    for (int j = 0; j <= rate; ++j)
+        for (int i = 0; i <= rate; ++i)
+        {
+            Point2f uv = patch.uvBounds.Lerp(Point2f((float)i / rate, (float)j / rate));
+            mesh->p[j * (rate + 1) + i] = BaseP(uv) + BaseN(uv) * (map->Evaluate(uv) * scale);
+        }
+    mesh->rowBounds.resize(rate);
+    for (int j = 0; j < rate; ++j)
+    {
+        Point3f small(Infinity), big(-Infinity);
+        for (int i = 0; i <= rate; ++i)
+            for (int k = 0; k < 2; ++k)
+            {
+                small = Min(small, mesh->P(i, j + k));
+                big = Max(big, mesh->P(i, j + k));
+            }
+        mesh->rowBounds[j] = AABB(small - Vector3f(0.0001f), big + Vector3f(0.0001f));
+    }
+    return mesh;
+}
+
+bool DisplacedPatch::IntersectHit(const Ray &ray, RawHit &hit) const
+{
+    const MicroMesh *mesh = surface->Tessellate(*this);
+
+    bool hitAnything = false;
+    int hitI = 0, hitJ = 0, hitUpper = 0;
+    float hitB1 = 0, hitB2 = 0;
+    for (int j = 0; j < rate; ++j)
+    {
+        if (!mesh->rowBounds[j].hit(ray, 0, ray.tMax)) continue;
+        for (int i = 0; i < rate; ++i)
+        {
+            const Point3f &a = mesh->P(i, j), &b = mesh->P(i + 1, j);
+            const Point3f &c = mesh->P(i + 1, j + 1), &d = mesh->P(i, j + 1);
+            float t, b0, b1, b2;
+            if (IntersectTriangle(ray, a, b, c, &t, &b0, &b1, &b2))
+            {
+                ray.tMax = t;
+                hitAnything = true;
+                hitI = i; hitJ = j; hitUpper = 0; hitB1 = b1; hitB2 = b2;
+            }
+            if (IntersectTriangle(ray, a, c, d, &t, &b0, &b1, &b2))
+            {
+                ray.tMax = t;
+                hitAnything = true;
+                hitI = i; hitJ = j; hitUpper = 1; hitB1 = b1; hitB2 = b2;
+            }
+        }
+    }
+    if (!hitAnything) return false;
+
+    surface->RecordHit(*this);
+    hit.t = ray.tMax;
+    hit.u = hitB1;
+    hit.v = hitB2;
+    hit.primID = (uint32_t)((hitJ * rate + hitI) * 2 + hitUpper);
+    hit.primitive = this;
+    return true;
+}
+
+void DisplacedPatch::ComputeSurfaceInteraction(const Ray &ray, const RawHit &hit, HitRecord &isect) const
+{
+    // pinned by IntersectHit; if it was evicted since, retessellating gives the same vertices
+    const MicroMesh *mesh = surface->HitMesh(*this);
+    int hitUpper = hit.primID & 1, quad = hit.primID >> 1;
+    int hitI = quad % rate, hitJ = quad / rate;
+    float hitB1 = hit.u, hitB2 = hit.v;
+
+    // grid coordinates of the hit inside the patch, from the triangle's barycentrics
+    const Point3f &p0 = mesh->P(hitI, hitJ);
+    const Point3f &p1 = hitUpper ? mesh->P(hitI + 1, hitJ + 1) : mesh->P(hitI + 1, hitJ);
+    const Point3f &p2 = hitUpper ? mesh->P(hitI, hitJ + 1) : mesh->P(hitI + 1, hitJ + 1);
+    float gx = hitI + (hitUpper ? hitB1 : hitB1 + hitB2);
+    float gy = hitJ + (hitUpper ? hitB1 + hitB2 : hitB2);
+    Point2f uv = uvBounds.Lerp(Point2f(gx / rate, gy / rate));
+
+    float b0 = 1 - hitB1 - hitB2;
+    isect.t = hit.t;
+    isect.p = b0 * p0 + hitB1 * p1 + hitB2 * p2;
+    isect.pError = gamma(7) * (Abs(b0 * p0) + Abs(hitB1 * p1) + Abs(hitB2 * p2));
+    isect.u = uv.x;
+    isect.v = uv.y;
+    isect.set_face_normal(ray, Normalize(Cross(p1 - p0, p2 - p0)));
+    isect.mat_ptr = surface->mat_ptr;
+    isect.wo = -ray.d;
+    isect.object = this;
+    if (surface->mediumRecord) isect.mediumRecord = *surface->mediumRecord;
+}
+
+bool DisplacedPatch::hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const
+{
+    Ray ray(r.o, r.d, t_max, r.time, r.medium);
+    return Intersect(ray, rec) && rec.t >= t_min;
+}
+
+#endif
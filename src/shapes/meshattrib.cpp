@@ -0,0 +1,66 @@
+#include "meshattrib.h"
+
+static inline uint16_t EncodeUnorm16(float f) {
+    return (uint16_t)std::round(Clamp((f + 1) / 2, 0, 1) * 65535.f);
+}
+
+static inline float DecodeUnorm16(uint16_t v) {
+    return -1 + 2 * (v / 65535.f);
+}
+
+static inline float SignNotZero(float v) {
+    return (v < 0) ? -1.f : 1.f;
+}
+
+OctNormal EncodeOctahedral(const Vector3f &n) {
+    // Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over
+    float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (l1 == 0) return OctNormal{EncodeUnorm16(0.f), EncodeUnorm16(0.f)};
+    float invL1 = 1.f / l1;
+    float x = n.x * invL1, y = n.y * invL1;
+    if (n.z < 0) {
+        float ox = x;
+        x = (1 - std::abs(y)) * SignNotZero(ox);
+        y = (1 - std::abs(ox)) * SignNotZero(y);
+    }
+    OctNormal e;
+    e.x = EncodeUnorm16(x);
+    e.y = EncodeUnorm16(y);
+    return e;
+}
+
+Vector3f DecodeOctahedral(const OctNormal &e) {
+    Vector3f v(DecodeUnorm16(e.x), DecodeUnorm16(e.y), 0.f);
+    v.z = 1 - (std::abs(v.x) + std::abs(v.y));
+    if (v.z < 0) {
+        float ox = v.x;
+        v.x = (1 - std::abs(v.y)) * SignNotZero(ox);
+        v.y = (1 - std::abs(ox)) * SignNotZero(v.y);
+    }
+    return Normalize(v);
+}
+
+void MeshAttributes::SetNormals(const std::vector<Vector3f> &n) {
+    normals.resize(n.size());
+    for (size_t i = 0; i < n.size(); ++i)
+        normals[i] = EncodeOctahedral(n[i]);
+}
+
+void MeshAttributes::SetUVs(const std::vector<Point2f> &uv) {
+    uvs.resize(uv.size());
+    if (uv.empty()) return;
+
+    Bounds2f bounds;
+    for (const Point2f &p : uv)
+        bounds = Bounds2f(Point2f(std::min(bounds.pMin.x, p.x), std::min(bounds.pMin.y, p.y)),
+                          Point2f(std::max(bounds.pMax.x, p.x), std::max(bounds.pMax.y, p.y)));
+    Vector2f extent = bounds.Diagonal();
+    uvMin = bounds.pMin;
+    uvScale = Vector2f(extent.x / 65535.f, extent.y / 65535.f);
+
+    for (size_t i = 0; i < uv.size(); ++i) {
+        Vector2f o = bounds.Offset(uv[i]);
+        uvs[i].u = (uint16_t)std::round(Clamp(o.x, 0, 1) * 65535.f);
+        uvs[i].v = (uint16_t)std::round(Clamp(o.y, 0, 1) * 65535.f);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef SHAPES_MESHATTRIB_H
+#define SHAPES_MESHATTRIB_H
+
+#include "../core/vector.h"
+#include "../core/memory.h"
+
+/*
+compressed per-vertex attribute streams for triangle meshes:
+normals are octahedral encoded into 2 x 16 bits, UVs are quantized to
+2 x 16 bits over the mesh's UV bounds. Both are decoded only at shading time.
+*/
+
+struct OctNormal {
+    uint16_t x, y;
+};
+
+OctNormal EncodeOctahedral(const Vector3f &n);
+Vector3f DecodeOctahedral(const OctNormal &e);
+
+struct QuantizedUV {
+    uint16_t u, v;
+};
+
+class MeshAttributes {
+public:
+    // the streams come from arena when one is given
+    MeshAttributes(SceneArena *arena = nullptr)
+        : normals(SceneAllocator<OctNormal>(arena)), uvs(SceneAllocator<QuantizedUV>(arena)) {}
+
+    void SetNormals(const std::vector<Vector3f> &n);
+    void SetUVs(const std::vector<Point2f> &uv);
+
+    bool HasNormals() const { return !normals.empty(); }
+    bool HasUVs() const { return !uvs.empty(); }
+
+    Vector3f Normal(int i) const { return DecodeOctahedral(normals[i]); }
+    Point2f UV(int i) const {
+        return Point2f(uvMin.x + uvs[i].u * uvScale.x, uvMin.y + uvs[i].v * uvScale.y);
+    }
+
+    size_t Bytes() const {
+        return normals.size() * sizeof(OctNormal) + uvs.size() * sizeof(QuantizedUV);
+    }
+    size_t UncompressedBytes() const {
+        return normals.size() * sizeof(Vector3f) + uvs.size() * sizeof(Point2f);
+    }
+
+private:
+    SceneVector<OctNormal> normals;
+    SceneVector<QuantizedUV> uvs;
+    Point2f uvMin, uvScale;
+};
+
+#endif
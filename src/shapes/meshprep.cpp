@@ -0,0 +1,179 @@
+#include "meshprep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+struct WeldKey {
+    uint64_t bits[8];
+    bool operator==(const WeldKey &k) const { return memcmp(bits, k.bits, sizeof(bits)) == 0; }
+};
+
+struct WeldKeyHash {
+    size_t operator()(const WeldKey &k) const {
+        uint64_t h = 14695981039346656037ull;
+        for (int i = 0; i < 8; ++i) {
+            h ^= k.bits[i];
+            h *= 1099511628211ull;
+        }
+        return (size_t)h;
+    }
+};
+
+static uint64_t WeldBits(float v, float epsilon) {
+    if (epsilon > 0) {
+        // 64-bit grid cells, clamped so llround stays defined for any coordinate and epsilon
+        double cell = Clamp((double)v / epsilon, -0x1p62, 0x1p62);
+        return (uint64_t)std::llround(cell);
+    }
+    // exact welding compares bit patterns, with -0 folded onto +0
+    if (v == 0.f) v = 0.f;
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(float));
+    return bits;
+}
+
+static WeldKey MakeWeldKey(const MeshBuffers &mesh, size_t i, float epsilon) {
+    WeldKey key;
+    memset(key.bits, 0, sizeof(key.bits));
+    for (int c = 0; c < 3; ++c)
+        key.bits[c] = WeldBits(mesh.positions[i][c], epsilon);
+    // attributes must match exactly, otherwise hard edges and UV seams would be lost
+    if (!mesh.normals.empty())
+        for (int c = 0; c < 3; ++c)
+            key.bits[3 + c] = WeldBits(mesh.normals[i][c], 0.f);
+    if (!mesh.uvs.empty())
+        for (int c = 0; c < 2; ++c)
+            key.bits[6 + c] = WeldBits(mesh.uvs[i][c], 0.f);
+    return key;
+}
+
+// Keep vertex i at slot remap[i] (or drop it if remap[i] < 0)
+template <typename T>
+static void CompactStream(std::vector<T> &stream, const std::vector<int> &remap, size_t count) {
+    if (stream.empty()) return;
+    std::vector<T> compacted(count);
+    for (size_t i = 0; i < remap.size(); ++i)
+        if (remap[i] >= 0) compacted[remap[i]] = stream[i];
+    stream.swap(compacted);
+}
+
+static void CompactVertices(MeshBuffers &mesh, const std::vector<int> &remap, size_t count) {
+    CompactStream(mesh.positions, remap, count);
+    CompactStream(mesh.normals, remap, count);
+    CompactStream(mesh.uvs, remap, count);
+}
+
+// Spread the lower 10 bits of x so there are two zero bits between each of them
+static inline uint32_t LeftShift3(uint32_t x) {
+    if (x == (1 << 10)) --x;
+    x = (x | (x << 16)) & 0x30000ff;
+    x = (x | (x << 8)) & 0x300f00f;
+    x = (x | (x << 4)) & 0x30c30c3;
+    x = (x | (x << 2)) & 0x9249249;
+    return x;
+}
+
+static inline uint32_t EncodeMorton3(const Vector3f &v) {
+    return (LeftShift3((uint32_t)v.z) << 2) | (LeftShift3((uint32_t)v.y) << 1) | LeftShift3((uint32_t)v.x);
+}
+
+static void WeldVertices(MeshBuffers &mesh, float epsilon) {
+    std::unordered_map<WeldKey, int, WeldKeyHash> unique;
+    unique.reserve(mesh.positions.size());
+    std::vector<int> canonical(mesh.positions.size());
+    std::vector<int> remap(mesh.positions.size(), -1);
+    for (size_t i = 0; i < mesh.positions.size(); ++i) {
+        auto it = unique.emplace(MakeWeldKey(mesh, i, epsilon), (int)unique.size());
+        // the first occurrence keeps a slot, later duplicates are dropped
+        if (it.second) remap[i] = it.first->second;
+        canonical[i] = it.first->second;
+    }
+    for (int &idx : mesh.indices) idx = canonical[idx];
+    CompactVertices(mesh, remap, unique.size());
+}
+
+static size_t RemoveDegenerateTriangles(MeshBuffers &mesh) {
+    std::vector<int> &indices = mesh.indices;
+    const std::vector<Point3f> &positions = mesh.positions;
+    size_t nTriangles = indices.size() / 3, kept = 0;
+    for (size_t t = 0; t < nTriangles; ++t) {
+        int i0 = indices[3 * t], i1 = indices[3 * t + 1], i2 = indices[3 * t + 2];
+        if (i0 == i1 || i1 == i2 || i0 == i2) continue;
+        Vector3f n = Cross(positions[i1] - positions[i0], positions[i2] - positions[i0]);
+        if (n.LengthSquared() == 0.f || n.HasNaNs()) continue;
+        indices[3 * kept] = i0;
+        indices[3 * kept + 1] = i1;
+        indices[3 * kept + 2] = i2;
+        ++kept;
+    }
+    indices.resize(3 * kept);
+    return nTriangles - kept;
+}
+
+static void MortonReorder(MeshBuffers &mesh) {
+    const std::vector<Point3f> &positions = mesh.positions;
+    const std::vector<int> &indices = mesh.indices;
+    size_t nTriangles = indices.size() / 3;
+    if (nTriangles == 0) return;
+
+    std::vector<Point3f> centroids(nTriangles);
+    Bounds3f centroidBounds;
+    for (size_t t = 0; t < nTriangles; ++t) {
+        centroids[t] = (positions[indices[3 * t]] + positions[indices[3 * t + 1]] + positions[indices[3 * t + 2]]) / 3.f;
+        centroidBounds = Union(centroidBounds, centroids[t]);
+    }
+
+    const int mortonScale = 1 << 10;
+    std::vector<std::pair<uint32_t, int>> codes(nTriangles);
+    for (size_t t = 0; t < nTriangles; ++t) {
+        Vector3f offset = centroidBounds.Offset(centroids[t]);
+        codes[t] = std::make_pair(EncodeMorton3(offset * (float)mortonScale), (int)t);
+    }
+    std::stable_sort(codes.begin(), codes.end(),
+                     [](const std::pair<uint32_t, int> &a, const std::pair<uint32_t, int> &b) { return a.first < b.first; });
+
+    // Renumber vertices in first-use order so they follow the triangles in memory
+    std::vector<int> remap(positions.size(), -1);
+    std::vector<int> sorted(indices.size());
+    int nVertices = 0;
+    for (size_t t = 0; t < nTriangles; ++t) {
+        int src = codes[t].second;
+        for (int k = 0; k < 3; ++k) {
+            int idx = indices[3 * src + k];
+            if (remap[idx] < 0) remap[idx] = nVertices++;
+            sorted[3 * t + k] = remap[idx];
+        }
+    }
+    mesh.indices.swap(sorted);
+    CompactVertices(mesh, remap, nVertices);
+}
+
+MeshPrepStats PreprocessMesh(MeshBuffers &mesh, const MeshPrepOptions &options) {
+    MeshPrepStats stats;
+    stats.verticesBefore = mesh.positions.size();
+    stats.trianglesBefore = mesh.indices.size() / 3;
+
+    if (options.weld)
+        WeldVertices(mesh, options.weldEpsilon);
+    if (options.removeDegenerate)
+        stats.degenerateRemoved = RemoveDegenerateTriangles(mesh);
+    if (options.mortonReorder)
+        MortonReorder(mesh);
+
+    stats.verticesAfter = mesh.positions.size();
+    stats.trianglesAfter = mesh.indices.size() / 3;
+    return stats;
+}
+
+void MeshPrepStats::Report(const std::string &name, size_t bytesPerTriangle) const {
+    std::cout << "Mesh preprocessing: " << name << "\n";
+    std::cout << "  vertices : " << verticesBefore << " -> " << verticesAfter << "\n";
+    std::cout << "  triangles: " << trianglesBefore << " -> " << trianglesAfter
+              << " (" << degenerateRemoved << " degenerate removed)\n";
+    std::cout << "  memory   : " << TriangleBytesBefore(bytesPerTriangle) / 1024 << " KB -> "
+              << TriangleBytesAfter(bytesPerTriangle) / 1024 << " KB of Triangle objects (" << bytesPerTriangle << " bytes each)\n";
+}
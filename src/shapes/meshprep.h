@@ -0,0 +1,43 @@
+#ifndef SHAPES_MESHPREP_H
+#define SHAPES_MESHPREP_H
+
+#include "../core/vector.h"
+
+#include <string>
+#include <vector>
+
+/*
+load-time mesh preprocessing: vertex welding, degenerate triangle removal
+and Morton (Z-order) triangle reordering, run before the triangles are built
+*/
+
+struct MeshPrepOptions {
+    bool weld = true;
+    float weldEpsilon = 0.f;        // 0 welds bit-identical positions only
+    bool removeDegenerate = true;
+    bool mortonReorder = true;
+};
+
+struct MeshPrepStats {
+    size_t verticesBefore = 0, verticesAfter = 0;
+    size_t trianglesBefore = 0, trianglesAfter = 0;
+    size_t degenerateRemoved = 0;
+
+    // The scene keeps every triangle as a standalone Triangle with its own copy of
+    // the positions, so welding saves nothing there; only removed triangles do
+    size_t TriangleBytesBefore(size_t bytesPerTriangle) const { return trianglesBefore * bytesPerTriangle; }
+    size_t TriangleBytesAfter(size_t bytesPerTriangle) const { return trianglesAfter * bytesPerTriangle; }
+    void Report(const std::string &name, size_t bytesPerTriangle) const;
+};
+
+struct MeshBuffers {
+    std::vector<Point3f> positions;
+    std::vector<Vector3f> normals;  // optional, parallel to positions
+    std::vector<Point2f> uvs;       // optional, parallel to positions
+    std::vector<int> indices;       // three per triangle
+};
+
+// All buffers are rewritten in place; vertices only weld if their attributes match too
+MeshPrepStats PreprocessMesh(MeshBuffers &mesh, const MeshPrepOptions &options = MeshPrepOptions());
+
+#endif
@@ -0,0 +1,227 @@
+#ifndef RENDERER_PARTICLES_H
+#define RENDERER_PARTICLES_H
+
+#include "../core/object.h"
+
+#include <algorithm>
+
+/*
+particle cloud: millions of spheres in one primitive. Centers and radii are
+stored as structure-of-arrays, grouped into BVH leaves of ParticleLanes
+spheres that are intersected together in one vectorized loop.
+*/
+
+static constexpr int ParticleLanes = 8;
+
+struct ParticleNode
+{
+    float bMin[3], bMax[3];
+    int offset;   // leaf: first lane block, interior: index of the second child
+    int nBlocks;  // 0 for interior nodes
+};
+
+class ParticleCloud : public Object
+{
+public:
+    ParticleCloud(const std::vector<Point3f> &centers, const std::vector<float> &radii,
+                  const Material *m, const MediumRecord *mediumRecord = nullptr)
+        : mat_ptr(m), Object(mediumRecord)
+    {
+        std::vector<int> order(centers.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = (int)i;
+        nodes.reserve(2 * centers.size() / ParticleLanes + 1);
+        if (!order.empty())
+            Build(centers, radii, order, 0, (int)order.size());
+        nParticles = centers.size();
+    }
+
+    virtual bool hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const override
+    {
+        Ray ray(r.o, r.d, t_max, r.time, r.medium);
+        return Intersect(ray, rec) && rec.t >= t_min;
+    }
+
+    virtual bool bounding_box(double time0, double time1, AABB &output_box) const override
+    {
+        if (nodes.empty()) return false;
+        output_box = AABB(Point3f(nodes[0].bMin[0], nodes[0].bMin[1], nodes[0].bMin[2]),
+                          Point3f(nodes[0].bMax[0], nodes[0].bMax[1], nodes[0].bMax[2]));
+        return true;
+    }
+
+    virtual bool IntersectHit(const Ray &ray, RawHit &hit) const override;
+    virtual void ComputeSurfaceInteraction(const Ray &ray, const RawHit &hit, HitRecord &isect) const override;
+
+    size_t Bytes() const
+    {
+        return (cx.size() + cy.size() + cz.size() + r.size()) * sizeof(float) + nodes.size() * sizeof(ParticleNode);
+    }
+
+public:
+    const Material *mat_ptr;
+    size_t nParticles = 0;
+
+private:
+    int Build(const std::vector<Point3f> &centers, const std::vector<float> &radii,
+              std::vector<int> &order, int start, int end);
+    bool IntersectBlock(const Ray &ray, int block, float *tHit, int *lane) const;
+
+    // padded to a multiple of ParticleLanes; unused lanes have a negative radius
+    std::vector<float> cx, cy, cz, r;
+    std::vector<ParticleNode> nodes;
+};
+
+int ParticleCloud::Build(const std::vector<Point3f> &centers, const std::vector<float> &radii,
+                         std::vector<int> &order, int start, int end)
+{
+    int nodeIndex = (int)nodes.size();
+    nodes.push_back(ParticleNode());
+
+    Point3f bMin(Infinity), bMax(-Infinity), cMin(Infinity), cMax(-Infinity);
+    for (int i = start; i < end; ++i)
+    {
+        const Point3f &c = centers[order[i]];
+        Vector3f rad(std::abs(radii[order[i]]));
+        bMin = Min(bMin, c - rad);
+        bMax = Max(bMax, c + rad);
+        cMin = Min(cMin, c);
+        cMax = Max(cMax, c);
+    }
+    for (int a = 0; a < 3; ++a)
+    {
+        nodes[nodeIndex].bMin[a] = bMin[a];
+        nodes[nodeIndex].bMax[a] = bMax[a];
+    }
+
+    int count = end - start;
+    if (count <= ParticleLanes)
+    {
+        // leaf: one block of lanes, padding never hits
+        nodes[nodeIndex].offset = (int)(cx.size() / ParticleLanes);
+        nodes[nodeIndex].nBlocks = 1;
+        for (int k = 0; k < ParticleLanes; ++k)
+        {
+            bool valid = k < count;
+            const Point3f c = valid ? centers[order[start + k]] : Point3f(0.f);
+            cx.push_back(c.x);
+            cy.push_back(c.y);
+            cz.push_back(c.z);
+            r.push_back(valid ? std::abs(radii[order[start + k]]) : -1.f);
+        }
+        return nodeIndex;
+    }
+
+    // median split of the centroids along the widest axis
+    int axis = MaxDimension(cMax - cMin);
+    int mid = (start + end) / 2;
+    std::nth_element(order.begin() + start, order.begin() + mid, order.begin() + end,
+                     [&](int a, int b) { return centers[a][axis] < centers[b][axis]; });
+
+    Build(centers, radii, order, start, mid);
+    int second = Build(centers, radii, order, mid, end);
+    nodes[nodeIndex].offset = second;
+    nodes[nodeIndex].nBlocks = 0;
+    return nodeIndex;
+}
+
+bool ParticleCloud::IntersectBlock(const Ray &ray, int block, float *tHit, int *lane) const
+{
+    const float *bx = &cx[block * ParticleLanes], *by = &cy[block * ParticleLanes];
+    const float *bz = &cz[block * ParticleLanes], *br = &r[block * ParticleLanes];
+    const float a = ray.d.LengthSquared(), invA = 1.f / a;
+    const float tMax = *tHit;
+    float tLane[ParticleLanes];
+
+#pragma omp simd
+    for (int k = 0; k < ParticleLanes; ++k)
+    {
+        float ocx = ray.o.x - bx[k], ocy = ray.o.y - by[k], ocz = ray.o.z - bz[k];
+        float halfB = ocx * ray.d.x + ocy * ray.d.y + ocz * ray.d.z;
+        float c = ocx * ocx + ocy * ocy + ocz * ocz - br[k] * br[k];
+        float discriminant = halfB * halfB - a * c;
+        float sqrtd = std::sqrt(std::max(discriminant, 0.f));
+        float t0 = (-halfB - sqrtd) * invA, t1 = (-halfB + sqrtd) * invA;
+        // entering root from outside, leaving root from inside, as in Sphere::Intersect
+        float t = (c > 0) ? t0 : t1;
+        bool valid = br[k] >= 0 && discriminant >= 0 && t > 0 && t < tMax;
+        tLane[k] = valid ? t : Infinity;
+    }
+
+    bool found = false;
+    for (int k = 0; k < ParticleLanes; ++k)
+        if (tLane[k] < *tHit)
+        {
+            *tHit = tLane[k];
+            *lane = block * ParticleLanes + k;
+            found = true;
+        }
+    return found;
+}
+
+bool ParticleCloud::IntersectHit(const Ray &ray, RawHit &hit) const
+{
+    if (nodes.empty()) return false;
+
+    Vector3f invDir(1.f / ray.d.x, 1.f / ray.d.y, 1.f / ray.d.z);
+    float tHit = ray.tMax;
+    int hitLane = -1;
+
+    int stack[64], top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const ParticleNode &node = nodes[stack[--top]];
+
+        float t0 = 0, t1 = tHit;
+        bool miss = false;
+        for (int a = 0; a < 3 && !miss; ++a)
+        {
+            float tNear = (node.bMin[a] - ray.o[a]) * invDir[a];
+            float tFar = (node.bMax[a] - ray.o[a]) * invDir[a];
+            if (tNear > tFar) std::swap(tNear, tFar);
+            t0 = tNear > t0 ? tNear : t0;
+            t1 = tFar < t1 ? tFar : t1;
+            miss = t0 > t1;
+        }
+        if (miss) continue;
+
+        if (node.nBlocks > 0)
+        {
+            for (int b = 0; b < node.nBlocks; ++b)
+                IntersectBlock(ray, node.offset + b, &tHit, &hitLane);
+        }
+        else
+        {
+            int first = (int)(&node - &nodes[0]) + 1;
+            stack[top++] = node.offset;
+            stack[top++] = first;
+        }
+    }
+    if (hitLane < 0) return false;
+
+    ray.tMax = tHit;
+    hit.t = tHit;
+    hit.u = hit.v = 0;
+    hit.primID = (uint32_t)hitLane;
+    hit.primitive = this;
+    return true;
+}
+
+void ParticleCloud::ComputeSurfaceInteraction(const Ray &ray, const RawHit &hit, HitRecord &isect) const
+{
+    int hitLane = (int)hit.primID;
+    Point3f center(cx[hitLane], cy[hitLane], cz[hitLane]);
+    isect.t = hit.t;
+    Vector3f pHit = ray(hit.t) - center;
+    pHit = pHit * (r[hitLane] / pHit.Length());
+    isect.p = center + pHit;
+    isect.pError = gamma(5) * Abs(pHit) + gamma(1) * Abs(isect.p);
+    isect.set_face_normal(ray, pHit / r[hitLane]);
+    isect.u = isect.v = 0;
+    isect.mat_ptr = mat_ptr;
+    isect.wo = -ray.d;
+    isect.object = this;
+    if (mediumRecord) isect.mediumRecord = *mediumRecord;
+}
+
+#endif
@@ -6,8 +6,8 @@
 class Sphere : public Object
 {
 public:
-    Sphere(Point3f cen, double r, shared_ptr<Material> m, std::shared_ptr<MediumRecord> mediumRecord = nullptr)
-        : center(cen), radius(r), mat_ptr(m), Object(mediumRecord) {};
+    Sphere(Point3f cen, double r, const Material *m, const MediumRecord *mediumRecord = nullptr)
+        : center(cen), radius(r), mat_ptr(m), Object(mediumRecord, ShapeType::Sphere) {};
 
     virtual bool hit(
         const Ray &r, double t_min, double t_max, HitRecord &rec) const override;
@@ -16,18 +16,19 @@ public:
 
     virtual double pdf_value(const Point3f &o, const Vector3f &v) const override;
 
-    virtual Vector3f random(const Point3f &o) const override;
+    virtual Vector3f random(const Point3f &o, const Point2f &u) const override;
 
-    bool Intersect(const Ray &ray, HitRecord &isect) const;
+    virtual bool IntersectHit(const Ray &ray, RawHit &hit) const override;
+    virtual void ComputeSurfaceInteraction(const Ray &ray, const RawHit &hit, HitRecord &isect) const override;
 
 public:
     bool envmap;
     Point3f center;
     double radius;
-    shared_ptr<Material> mat_ptr;
+    const Material *mat_ptr;
 
 private:
-    static void get_Sphere_uv(const Point3f &p, double &u, double &v)
+    static void get_Sphere_uv(const Point3f &p, float &u, float &v)
     {
         auto theta = acos(-p.y);
         auto phi = atan2(-p.z, p.x) + PI;
@@ -37,7 +38,7 @@ private:
     }
 };
 
-bool Sphere::Intersect(const Ray &ray, HitRecord &isect) const {
+bool Sphere::IntersectHit(const Ray &ray, RawHit &hit) const {
     Vector3f oc = ray.o - center;
     auto a = ray.d.LengthSquared();
     auto half_b = Dot(oc, ray.d);
@@ -48,23 +49,32 @@ bool Sphere::Intersect(const Ray &ray, HitRecord &isect) const {
         return false;
     auto sqrtd = sqrt(discriminant);
 
-    auto root = (-half_b - sqrtd) / a;
-    if (ray.tMax < root || root < 1 - ShadowEpsilon) {
-        root = (-half_b + sqrtd) / a;
-        if (ray.tMax < root || root < 1 - ShadowEpsilon) {
-            return false;
-        }
-    }
+    // A ray starting outside (c > 0) can only enter, one inside can only leave;
+    // spawned rays are offset to the correct side, so they never re-hit the sphere
+    auto root = (c > 0) ? (-half_b - sqrtd) / a : (-half_b + sqrtd) / a;
+    if (ray.tMax < root || root <= 0)
+        return false;
 
     ray.tMax = root;
-    isect.t = root;
-    isect.p = ray(isect.t);
-    isect.normal = (isect.p - center) / radius;
+    hit.t = root;
+    hit.u = hit.v = 0;
+    hit.primID = 0;
+    hit.primitive = this;
+    return true;
+}
+
+void Sphere::ComputeSurfaceInteraction(const Ray &ray, const RawHit &hit, HitRecord &isect) const {
+    isect.t = hit.t;
+    // Reproject onto the surface, which bounds the error by the offset from the center
+    Vector3f pHit = ray(hit.t) - center;
+    pHit = pHit * (float)(radius / pHit.Length());
+    isect.p = center + pHit;
+    isect.pError = gamma(5) * Abs(pHit) + gamma(1) * Abs(isect.p);
+    isect.normal = pHit / radius;
     isect.mat_ptr = mat_ptr;
     isect.wo = -ray.d;
-    isect.mediumRecord = *mediumRecord;
-
-    return true;
+    isect.object = this;
+    if (mediumRecord) isect.mediumRecord = *mediumRecord;
 }
 
 bool Sphere::hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const
@@ -119,7 +129,7 @@ double Sphere::pdf_value(const Point3f &o, const Vector3f &v) const
     return 1 / solid_angle;
 }
 
-Vector3f Sphere::random(const Point3f &o) const
+Vector3f Sphere::random(const Point3f &o, const Point2f &u) const
 {
     return Vector3f();
 }
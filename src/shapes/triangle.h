@@ -2,12 +2,18 @@
 #define RENDERER_TRIANGLE_H
 
 #include "../core/object.h"
+#include "meshprep.h"
+#include "meshattrib.h"
+#include "../core/memory.h"
+
+#include <map>
+#include <tuple>
 
 class Triangle : public Object
 {
 public:
-    Triangle(Vector3f _v0, Vector3f _v1, Vector3f _v2, shared_ptr<Material> m, std::shared_ptr<MediumRecord> mediumRecord = nullptr)
-         : v0(_v0), v1(_v1), v2(_v2), mat_ptr(m), Object(mediumRecord) {
+    Triangle(Vector3f _v0, Vector3f _v1, Vector3f _v2, const Material *m, const MediumRecord *mediumRecord = nullptr)
+         : v0(_v0), v1(_v1), v2(_v2), mat_ptr(m), Object(mediumRecord, ShapeType::Triangle) {
         e1 = v1 - v0;
         e2 = v2 - v0;
         normal = Normalize(Cross(e1, e2));
@@ -16,48 +22,153 @@ public:
 
     virtual bool hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const override;
     virtual bool bounding_box(double time0, double time1, AABB &output_box) const override;
-    virtual bool Intersect(const Ray &ray, HitRecord &isect) const override;
+    virtual bool IntersectHit(const Ray &ray, RawHit &hit) const override;
+    virtual void ComputeSurfaceInteraction(const Ray &ray, const RawHit &hit, HitRecord &isect) const override;
+    virtual void ComputeShadingGeometry(HitRecord &isect) const override;
+    virtual Point2f HitUV(const RawHit &hit) const override;
+
+    // attr is not owned, it has to outlive the triangle
+    void SetAttributes(const MeshAttributes *attr, int i0, int i1, int i2) {
+        attributes = attr;
+        vi[0] = i0; vi[1] = i1; vi[2] = i2;
+    }
 
 public:
     Vector3f v0, v1, v2; // vertices A, B, C, counter-clockwise order
     Vector3f e1, e2; // 2 edges v1-v0, v2-v0
-    Vector3f t0, t1, t2; // texture coords
     Vector3f normal;
     double area;
-    std::shared_ptr<Material> mat_ptr;
+    const Material *mat_ptr;
+    const MeshAttributes *attributes = nullptr; // shading normals and UVs, shared by the mesh
+    int vi[3] = {0, 0, 0}; // vertex indices into attributes
 };
-
-bool Triangle::Intersect(const Ray &ray, HitRecord &isect) const {
-    Vector3f edge1 = v1 - v0;
-    Vector3f edge2 = v2 - v0;
-    Vector3f pvec = Cross(ray.d, edge2);
-    float det = AbsDot(edge1, pvec);
-    if (det == 0)
+// a mesh's triangles are dropped with the scene's arena, one by one they would dominate teardown
+static_assert(std::is_trivially_destructible<Triangle>::value, "Triangle must not own anything");
+
+// Watertight ray-triangle test (PBRT 3.6.2). On a hit, t is conservatively
+// positive and b0, b1, b2 are the barycentric weights of p0, p1, p2.
+inline bool IntersectTriangle(const Ray &ray, const Point3f &p0, const Point3f &p1, const Point3f &p2,
+                              float *tHit, float *b0, float *b1, float *b2) {
+    // Translate vertices based on ray origin
+    Point3f p0t = p0 - ray.o;
+    Point3f p1t = p1 - ray.o;
+    Point3f p2t = p2 - ray.o;
+
+    // Permute components of triangle vertices and ray direction
+    int kz = MaxDimension(Abs(ray.d));
+    int kx = kz + 1;
+    if (kx == 3) kx = 0;
+    int ky = kx + 1;
+    if (ky == 3) ky = 0;
+    Vector3f d = Permute(ray.d, kx, ky, kz);
+    p0t = Permute(p0t, kx, ky, kz);
+    p1t = Permute(p1t, kx, ky, kz);
+    p2t = Permute(p2t, kx, ky, kz);
+
+    // Apply shear transformation to translated vertex positions
+    float Sx = -d.x / d.z;
+    float Sy = -d.y / d.z;
+    float Sz = 1.f / d.z;
+    p0t.x += Sx * p0t.z;
+    p0t.y += Sy * p0t.z;
+    p1t.x += Sx * p1t.z;
+    p1t.y += Sy * p1t.z;
+    p2t.x += Sx * p2t.z;
+    p2t.y += Sy * p2t.z;
+
+    // Compute edge function coefficients, falling back to double precision at the edges
+    float e0 = p1t.x * p2t.y - p1t.y * p2t.x;
+    float e1 = p2t.x * p0t.y - p2t.y * p0t.x;
+    float e2 = p0t.x * p1t.y - p0t.y * p1t.x;
+    if (e0 == 0.0f || e1 == 0.0f || e2 == 0.0f) {
+        e0 = (float)((double)p1t.x * (double)p2t.y - (double)p1t.y * (double)p2t.x);
+        e1 = (float)((double)p2t.x * (double)p0t.y - (double)p2t.y * (double)p0t.x);
+        e2 = (float)((double)p0t.x * (double)p1t.y - (double)p0t.y * (double)p1t.x);
+    }
+    if ((e0 < 0 || e1 < 0 || e2 < 0) && (e0 > 0 || e1 > 0 || e2 > 0))
         return false;
-
-    Vector3f tvec = ray.o - v0;
-    isect.u = Dot(tvec, pvec);
-    if (isect.u < 1 - ShadowEpsilon || isect.u > det)
+    float det = e0 + e1 + e2;
+    if (det == 0) return false;
+
+    // Compute scaled hit distance to triangle and test against ray t range
+    p0t.z *= Sz;
+    p1t.z *= Sz;
+    p2t.z *= Sz;
+    float tScaled = e0 * p0t.z + e1 * p1t.z + e2 * p2t.z;
+    if (det < 0 && (tScaled >= 0 || tScaled < ray.tMax * det))
         return false;
-
-    Vector3f qvec = Cross(tvec, edge1);
-    isect.v = Dot(ray.d, qvec);
-    if (isect.v < 1 - ShadowEpsilon || isect.u + isect.v > det)
+    else if (det > 0 && (tScaled <= 0 || tScaled > ray.tMax * det))
         return false;
 
     float invDet = 1 / det;
+    float t = tScaled * invDet;
+
+    // Ensure that computed triangle t is conservatively greater than zero
+    float maxZt = MaxComponent(Abs(Vector3f(p0t.z, p1t.z, p2t.z)));
+    float deltaZ = gamma(3) * maxZt;
+    float maxXt = MaxComponent(Abs(Vector3f(p0t.x, p1t.x, p2t.x)));
+    float maxYt = MaxComponent(Abs(Vector3f(p0t.y, p1t.y, p2t.y)));
+    float deltaX = gamma(5) * (maxXt + maxZt);
+    float deltaY = gamma(5) * (maxYt + maxZt);
+    float deltaE = 2 * (gamma(2) * maxXt * maxYt + deltaY * maxXt + deltaX * maxYt);
+    float maxE = MaxComponent(Abs(Vector3f(e0, e1, e2)));
+    float deltaT = 3 * (gamma(3) * maxE * maxZt + deltaE * maxZt + deltaZ * maxE) * std::abs(invDet);
+    if (t <= deltaT) return false;
+
+    *tHit = t;
+    *b0 = e0 * invDet;
+    *b1 = e1 * invDet;
+    *b2 = e2 * invDet;
+    return true;
+}
 
-    if (ray.tMax <= Dot(edge2, qvec) * invDet || Dot(edge2, qvec) * invDet < 0.0001f) return false;
+bool Triangle::IntersectHit(const Ray &ray, RawHit &hit) const {
+    float t, b0, b1, b2;
+    if (!IntersectTriangle(ray, v0, v1, v2, &t, &b0, &b1, &b2))
+        return false;
+    ray.tMax = t;
+    hit.t = t;
+    hit.u = b1;
+    hit.v = b2;
+    hit.primID = 0;
+    hit.primitive = this;
+    return true;
+}
 
-    ray.tMax = Dot(edge2, qvec) * invDet;
-    isect.t = ray.tMax;
-    isect.p = ray(isect.t);
-    isect.u *= invDet;
-    isect.v *= invDet;
+void Triangle::ComputeSurfaceInteraction(const Ray &ray, const RawHit &hit, HitRecord &isect) const {
+    float b1 = hit.u, b2 = hit.v, b0 = 1 - b1 - b2;
+    isect.t = hit.t;
+    // Interpolating the vertices gives a tighter error bound than ray(t)
+    isect.p = b0 * v0 + b1 * v1 + b2 * v2;
+    isect.pError = gamma(7) * (Abs(b0 * v0) + Abs(b1 * v1) + Abs(b2 * v2));
+    isect.u = b1;
+    isect.v = b2;
     isect.normal = normal;
     isect.mat_ptr = mat_ptr;
     isect.wo = -ray.d;
-    return true;
+    isect.object = this;
+}
+
+void Triangle::ComputeShadingGeometry(HitRecord &isect) const {
+    // isect.u and isect.v hold the barycentric weights of v1 and v2
+    float b1 = isect.u, b2 = isect.v, b0 = 1 - b1 - b2;
+    isect.shadingNormal = isect.normal;
+    isect.uv = Point2f(b1, b2);
+    if (!attributes) return;
+
+    if (attributes->HasNormals()) {
+        Vector3f ns = b0 * attributes->Normal(vi[0]) + b1 * attributes->Normal(vi[1]) + b2 * attributes->Normal(vi[2]);
+        if (ns.LengthSquared() > 0)
+            isect.shadingNormal = Faceforward(Normalize(ns), isect.normal);
+    }
+    if (attributes->HasUVs())
+        isect.uv = attributes->UV(vi[0]) * b0 + attributes->UV(vi[1]) * b1 + attributes->UV(vi[2]) * b2;
+}
+
+Point2f Triangle::HitUV(const RawHit &hit) const {
+    float b1 = hit.u, b2 = hit.v, b0 = 1 - b1 - b2;
+    if (!attributes || !attributes->HasUVs()) return Point2f(b1, b2);
+    return attributes->UV(vi[0]) * b0 + attributes->UV(vi[1]) * b1 + attributes->UV(vi[2]) * b2;
 }
 
 bool Triangle::hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const
@@ -117,7 +228,8 @@ bool Triangle::bounding_box(double time0, double time1, AABB &output_box) const
 class TriangleMesh : public Object
 {
 public:
-    TriangleMesh(const float &rotate_angle, const Vector3f &translate, const float &scale, std::string inputfile, std::string mtlsource, std::shared_ptr<Material> mat_ptr, std::shared_ptr<MediumRecord> mediumRecord = nullptr)
+    TriangleMesh(const float &rotate_angle, const Vector3f &translate, const float &scale, std::string inputfile, std::string mtlsource, const Material *mat_ptr, SceneArena &arena,
+                 const MediumRecord *mediumRecord = nullptr, const MeshPrepOptions &prepOptions = MeshPrepOptions())
         : Object(mediumRecord) {
         tinyobj::ObjReaderConfig reader_config;
         reader_config.mtl_search_path = mtlsource;
@@ -151,6 +263,11 @@ public:
         );
         Transform rotate = Transform(rotateByY);
 
+        // One mesh vertex per distinct (position, normal, texcoord) corner
+        MeshBuffers mesh;
+        std::map<std::tuple<int, int, int>, int> corners;
+        bool hasNormals = !attrib.normals.empty(), hasUVs = !attrib.texcoords.empty();
+
         // Loop over shapes
         for (size_t s = 0;  s < shapes.size(); s ++)
         {
@@ -160,33 +277,91 @@ public:
             {
                 size_t fv = size_t(shapes[s].mesh.num_face_vertices[f]);
 
-                // Loop over vertices in the face
-                std::vector<Vector3f> vertices;
-                for (size_t v = 0; v < fv; v ++)
+                // Faces are triangulated by the reader, only the first three vertices are used
+                for (size_t v = 0; v < 3; v ++)
                 {
                     tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-                    tinyobj::real_t vx = attrib.vertices[3*size_t(idx.vertex_index)+0];
-                    tinyobj::real_t vy = attrib.vertices[3*size_t(idx.vertex_index)+1];
-                    tinyobj::real_t vz = attrib.vertices[3*size_t(idx.vertex_index)+2];
-
-                    vertices.push_back(Vector3f(vx, vy, vz));
+                    auto corner = corners.emplace(std::make_tuple(idx.vertex_index, idx.normal_index, idx.texcoord_index),
+                                                  (int)mesh.positions.size());
+                    if (corner.second)
+                    {
+                        tinyobj::real_t vx = attrib.vertices[3*size_t(idx.vertex_index)+0];
+                        tinyobj::real_t vy = attrib.vertices[3*size_t(idx.vertex_index)+1];
+                        tinyobj::real_t vz = attrib.vertices[3*size_t(idx.vertex_index)+2];
+                        mesh.positions.push_back((Vector3f(vx, vy, vz) * scale) + translate);
+
+                        if (hasNormals)
+                        {
+                            Vector3f n(0.f);
+                            if (idx.normal_index >= 0)
+                                n = Vector3f(attrib.normals[3*size_t(idx.normal_index)+0],
+                                             attrib.normals[3*size_t(idx.normal_index)+1],
+                                             attrib.normals[3*size_t(idx.normal_index)+2]);
+                            mesh.normals.push_back(n);
+                        }
+                        if (hasUVs)
+                        {
+                            Point2f uv(0.f, 0.f);
+                            if (idx.texcoord_index >= 0)
+                                uv = Point2f(attrib.texcoords[2*size_t(idx.texcoord_index)+0],
+                                             attrib.texcoords[2*size_t(idx.texcoord_index)+1]);
+                            mesh.uvs.push_back(uv);
+                        }
+                    }
+                    mesh.indices.push_back(corner.first->second);
                 }
-
-                Triangle face = Triangle((vertices[0] * scale) + translate, (vertices[1] * scale) + translate, (vertices[2] * scale) + translate, mat_ptr, mediumRecord);
-                Triangles.push_back(face);
                 index_offset += fv;
 
                 // per-face material
                 shapes[s].mesh.material_ids[f];
             }
         }
+
+        // Corners without an OBJ normal take the area-weighted normal of their faces
+        if (hasNormals)
+        {
+            std::vector<Vector3f> faceSum(mesh.positions.size(), Vector3f(0.f));
+            for (size_t t = 0; t < mesh.indices.size() / 3; t ++)
+            {
+                const int *vi = &mesh.indices[3*t];
+                Vector3f n = Cross(mesh.positions[vi[1]] - mesh.positions[vi[0]], mesh.positions[vi[2]] - mesh.positions[vi[0]]);
+                for (int k = 0; k < 3; k ++) faceSum[vi[k]] += n;
+            }
+            for (size_t v = 0; v < mesh.normals.size(); v ++)
+                if (mesh.normals[v].LengthSquared() == 0 && faceSum[v].LengthSquared() > 0)
+                    mesh.normals[v] = Normalize(faceSum[v]);
+        }
+
+        MeshPrepStats stats = PreprocessMesh(mesh, prepOptions);
+        stats.Report(inputfile, sizeof(Triangle));
+
+        MeshAttributes *attributes = nullptr;
+        if (!mesh.normals.empty() || !mesh.uvs.empty())
+        {
+            attributes = arena.New<MeshAttributes>(&arena);
+            attributes->SetNormals(mesh.normals);
+            attributes->SetUVs(mesh.uvs);
+            std::cout << "  attributes: " << attributes->UncompressedBytes() / 1024 << " KB -> "
+                      << attributes->Bytes() / 1024 << " KB compressed\n";
+        }
+
+        Triangles.reserve(mesh.indices.size() / 3);
+        for (size_t t = 0; t < mesh.indices.size() / 3; t ++)
+        {
+            const int *vi = &mesh.indices[3*t];
+            Triangle *face = arena.New<Triangle>(mesh.positions[vi[0]], mesh.positions[vi[1]], mesh.positions[vi[2]], mat_ptr, mediumRecord);
+            if (attributes)
+                face->SetAttributes(attributes, vi[0], vi[1], vi[2]);
+            Triangles.push_back(face);
+        }
     }
 
     virtual bool hit(const Ray &r, double t_min, double t_max, HitRecord &rec) const {}
     virtual bool bounding_box(double time0, double time1, AABB &output_box) const {}
-    virtual bool Intersect(const Ray &ray, HitRecord &isect) const override {}
+    virtual bool IntersectHit(const Ray &ray, RawHit &hit) const override { return false; }
 public:
-    std::vector<Triangle> Triangles;
+    // made in the arena passed in, which owns them and their attributes
+    std::vector<Triangle *> Triangles;
 };
 
 